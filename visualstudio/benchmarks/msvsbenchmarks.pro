@@ -0,0 +1,12 @@
+# Micro-benchmarks of the generator functions which run per file or per configuration.
+# Each benchmark prints its time and heap allocations per operation, e.g. run
+# "tst_msvsbenchmarks -minimumtotal 200".
+TARGET = tst_msvsbenchmarks
+QT = core testlib
+CONFIG += console testcase
+CONFIG -= app_bundle
+
+include(../../../use_corelib.pri)
+include(../visualstudio.pri)
+
+SOURCES += tst_msvsbenchmarks.cpp
@@ -0,0 +1,319 @@
+/****************************************************************************
+**
+** Copyright (C) 2015 The Qt Company Ltd.
+** Contact: http://www.qt.io/licensing
+**
+** This file is part of the Qt Build Suite.
+**
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms and
+** conditions see http://www.qt.io/terms-conditions. For further information
+** use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file.  Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, The Qt Company gives you certain additional
+** rights.  These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+****************************************************************************/
+
+#include <visualstudio/msbuildprojectwriter.h>
+#include <visualstudio/msvspreparedproject.h>
+#include <visualstudio/visualstudioitemgroupfilter.h>
+#include <visualstudio/visualstudiosolutionwriter.h>
+#include <tools/version.h>
+#include <tools/visualstudioversioninfo.h>
+
+#include <QElapsedTimer>
+#include <QtTest>
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#if defined(_MSC_VER) && defined(_DEBUG)
+#include <crtdbg.h>
+#endif
+
+// Heap allocations of the whole process, where the platform allows hooking them. Qt containers
+// allocate with malloc() from the Qt libraries, so counting operator new alone misses them.
+static std::atomic<qint64> allocationCount(0);
+
+#if defined(__GLIBC__)
+// The definitions in the executable take precedence over those of the C library in all modules.
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *pointer, size_t size);
+
+void *malloc(size_t size) __THROW
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size) __THROW
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *pointer, size_t size) __THROW
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    return __libc_realloc(pointer, size);
+}
+}
+#elif defined(_MSC_VER) && defined(_DEBUG)
+// The debug CRT reports the allocations of all modules sharing it, which includes the Qt
+// debug libraries.
+static int countAllocation(int allocationType, void *, size_t, int, long,
+                           const unsigned char *, int)
+{
+    if (allocationType == _HOOK_ALLOC || allocationType == _HOOK_REALLOC)
+        allocationCount.fetch_add(1, std::memory_order_relaxed);
+    return TRUE;
+}
+#else
+// Elsewhere only the C++ allocations of this executable are counted, which includes the
+// generator sources but not the Qt libraries.
+void *operator new(size_t size)
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (void *pointer = std::malloc(size ? size : 1))
+        return pointer;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *pointer) noexcept
+{
+    std::free(pointer);
+}
+#endif
+
+using namespace qbs;
+
+namespace {
+
+// Reports the time and the allocations per operation of a QBENCHMARK loop. They include the
+// small overhead of the loop itself.
+class OperationMeter
+{
+public:
+    OperationMeter() : m_allocations(allocationCount.load())
+    {
+        m_timer.start();
+    }
+
+    void report(qint64 operations) const
+    {
+        const qint64 nsecs = m_timer.nsecsElapsed();
+        const qint64 allocations = allocationCount.load() - m_allocations;
+        qDebug("%s: %.1f ns/op, %.2f allocations/op", QTest::currentTestFunction(),
+               double(nsecs) / operations, double(allocations) / operations);
+    }
+
+private:
+    QElapsedTimer m_timer;
+    const qint64 m_allocations;
+};
+
+// Exposes the helpers which the writers use per file and per configuration.
+class BenchmarkProjectWriter : public MSBuildProjectWriter
+{
+public:
+    BenchmarkProjectWriter()
+        : MSBuildProjectWriter(Internal::VisualStudioVersionInfo(Version(14)))
+    {
+    }
+
+    using MSBuildProjectWriter::ProjectConfigurations;
+    using MSBuildProjectWriter::ProjectFileTags;
+    using MSBuildProjectWriter::projectFiles;
+    using MSBuildProjectWriter::qbsCommandLine;
+};
+
+MsvsProjectConfiguration configuration(const QString &profile, const QString &variant)
+{
+    MsvsProjectConfiguration config;
+    config.profile = profile;
+    config.variant = variant;
+    config.platform = QStringLiteral("x64");
+    config.qbsExecutablePath = QStringLiteral("C:/Qt/qbs/bin/qbs.exe");
+    config.qbsProjectFile = QStringLiteral("C:/work/project/project.qbs");
+    config.buildDirectory = QStringLiteral("C:/work/build");
+    config.installRoot = QStringLiteral("C:/work/build/install-root");
+    return config;
+}
+
+} // namespace
+
+class TestMsvsBenchmarks : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void matchesFilter();
+    void configurationHash();
+    void fullName();
+    void profileAndVariant();
+    void qbsCommandLine();
+    void disabledConfigurations();
+    void solutionConfigurationLines();
+
+private:
+    MsvsProjectConfiguration m_configuration;
+};
+
+void TestMsvsBenchmarks::initTestCase()
+{
+#if defined(_MSC_VER) && defined(_DEBUG)
+    _CrtSetAllocHook(countAllocation);
+#endif
+    m_configuration = configuration(QStringLiteral("msvc2015-x64"), QStringLiteral("release"));
+}
+
+void TestMsvsBenchmarks::matchesFilter()
+{
+    const QList<VisualStudioItemGroupFilter> filters
+            = VisualStudioItemGroupFilter::defaultItemGroupFilters();
+    const QString filePath = QStringLiteral("C:/work/project/src/lib/corelib/tools/fileinfo.h");
+    int matches = 0;
+    qint64 operations = 0;
+    const OperationMeter meter;
+    QBENCHMARK {
+        for (const VisualStudioItemGroupFilter &filter : filters) {
+            matches += filter.matchesFilter(filePath);
+            ++operations;
+        }
+    }
+    meter.report(operations);
+    QVERIFY(matches > 0);
+}
+
+void TestMsvsBenchmarks::configurationHash()
+{
+    quint32 hash = 0;
+    qint64 operations = 0;
+    const OperationMeter meter;
+    QBENCHMARK {
+        hash ^= qHash(m_configuration);
+        ++operations;
+    }
+    meter.report(operations);
+    Q_UNUSED(hash);
+}
+
+void TestMsvsBenchmarks::fullName()
+{
+    QString name;
+    qint64 operations = 0;
+    const OperationMeter meter;
+    QBENCHMARK {
+        name = m_configuration.fullName();
+        ++operations;
+    }
+    meter.report(operations);
+    QCOMPARE(name, QStringLiteral("msvc2015x64-release|x64"));
+}
+
+void TestMsvsBenchmarks::profileAndVariant()
+{
+    QString name;
+    qint64 operations = 0;
+    const OperationMeter meter;
+    QBENCHMARK {
+        name = m_configuration.profileAndVariant();
+        ++operations;
+    }
+    meter.report(operations);
+    QVERIFY(!name.isEmpty());
+}
+
+void TestMsvsBenchmarks::qbsCommandLine()
+{
+    const BenchmarkProjectWriter writer;
+    const QList<MsvsProjectConfiguration> buildTasks = QList<MsvsProjectConfiguration>()
+            << m_configuration;
+    const QString projectDirectory = QStringLiteral("C:/work/build");
+    QString commandLine;
+    qint64 operations = 0;
+    const OperationMeter meter;
+    QBENCHMARK {
+        commandLine = writer.qbsCommandLine(QStringLiteral("build"), QStringLiteral("corelib"),
+                                            buildTasks, projectDirectory);
+        ++operations;
+    }
+    meter.report(operations);
+    QVERIFY(commandLine.contains(QStringLiteral("profile:msvc2015-x64")));
+}
+
+void TestMsvsBenchmarks::disabledConfigurations()
+{
+    // Below the chunk size, so that the set difference is measured rather than the scheduling.
+    const int fileCount = 512;
+    QSet<MsvsProjectConfiguration> allConfigurations;
+    for (const QString &profile : QStringList() << QStringLiteral("msvc2015-x86")
+                                                << QStringLiteral("msvc2015-x64"))
+        for (const QString &variant : QStringList() << QStringLiteral("debug")
+                                                    << QStringLiteral("release"))
+            allConfigurations << configuration(profile, variant);
+
+    // Every fourth file is missing from one configuration.
+    BenchmarkProjectWriter::ProjectConfigurations allProjectFilesConfigurations;
+    BenchmarkProjectWriter::ProjectFileTags allProjectFileTags;
+    for (int i = 0; i < fileCount; ++i) {
+        const QString filePath = QStringLiteral("C:/work/project/src/file%1.cpp").arg(i);
+        QSet<MsvsProjectConfiguration> fileConfigurations = allConfigurations;
+        if (i % 4 == 0)
+            fileConfigurations.remove(m_configuration);
+        allProjectFilesConfigurations.insert(filePath, fileConfigurations);
+        allProjectFileTags.insert(filePath, QSet<QString>() << QStringLiteral("cpp"));
+    }
+
+    const BenchmarkProjectWriter writer;
+    int disabledCount = 0;
+    qint64 operations = 0;
+    const OperationMeter meter;
+    QBENCHMARK {
+        disabledCount = 0;
+        for (const auto &projectFile : writer.projectFiles(allConfigurations,
+                                                           allProjectFilesConfigurations,
+                                                           allProjectFileTags))
+            disabledCount += projectFile.disabledConfigurations.size();
+        operations += fileCount;
+    }
+    meter.report(operations);
+    QCOMPARE(disabledCount, fileCount / 4);
+}
+
+void TestMsvsBenchmarks::solutionConfigurationLines()
+{
+    const QString guid = QStringLiteral("{8A6B1E5C-2F3D-4E7A-9B0C-1D2E3F4A5B6C}");
+    const QString configurationName = m_configuration.fullName();
+    QString lines;
+    qint64 operations = 0;
+    const OperationMeter meter;
+    QBENCHMARK {
+        lines = VisualStudioSolutionWriter::projectConfigurationLines(guid, configurationName);
+        ++operations;
+    }
+    meter.report(operations);
+    QVERIFY(lines.endsWith(QStringLiteral(".Build.0 = msvc2015x64-release|x64\n")));
+}
+
+QTEST_MAIN(TestMsvsBenchmarks)
+
+#include "tst_msvsbenchmarks.moc"
@@ -29,15 +29,172 @@
 ****************************************************************************/
 
 #include "msbuildprojectwriter.h"
+#include "msvsmemoryaccounting.h"
+#include "msvsrenderbuffer.h"
+#include "msvsstagedoutput.h"
+#include "msvsstatistics.h"
 #include <tools/hostosinfo.h>
-#include <QFile>
-#include <QUuid>
-#include <QXmlStreamWriter>
+#include <tools/qbsassert.h>
+#include <tools/shellutils.h>
+#include <QDir>
+#include <QFileInfo>
 
 namespace qbs {
 
+// Element and attribute names of the MSBuild format.
+namespace MSBuildSchema {
+constexpr MsvsXmlName AdditionalDependencies("AdditionalDependencies");
+constexpr MsvsXmlName AdditionalIncludeDirectories("AdditionalIncludeDirectories");
+constexpr MsvsXmlName AdditionalLibraryDirectories("AdditionalLibraryDirectories");
+constexpr MsvsXmlName AdditionalOptions("AdditionalOptions");
+constexpr MsvsXmlName AfterTargets("AfterTargets");
+constexpr MsvsXmlName AlwaysCreate("AlwaysCreate");
+constexpr MsvsXmlName BeforeTargets("BeforeTargets");
+constexpr MsvsXmlName CharacterSet("CharacterSet");
+constexpr MsvsXmlName ClCompile("ClCompile");
+constexpr MsvsXmlName Command("Command");
+constexpr MsvsXmlName Condition("Condition");
+constexpr MsvsXmlName Configuration("Configuration");
+constexpr MsvsXmlName ConfigurationType("ConfigurationType");
+constexpr MsvsXmlName DebuggerFlavor("DebuggerFlavor");
+constexpr MsvsXmlName DefaultTargets("DefaultTargets");
+constexpr MsvsXmlName Delete("Delete");
+constexpr MsvsXmlName Directories("Directories");
+constexpr MsvsXmlName ExcludedFromBuild("ExcludedFromBuild");
+constexpr MsvsXmlName Exec("Exec");
+constexpr MsvsXmlName Extensions("Extensions");
+constexpr MsvsXmlName Files("Files");
+constexpr MsvsXmlName Filter("Filter");
+constexpr MsvsXmlName ForcedIncludeFiles("ForcedIncludeFiles");
+constexpr MsvsXmlName GenerateDebugInformation("GenerateDebugInformation");
+constexpr MsvsXmlName Import("Import");
+constexpr MsvsXmlName Importance("Importance");
+constexpr MsvsXmlName Include("Include");
+constexpr MsvsXmlName Inputs("Inputs");
+constexpr MsvsXmlName ItemDefinitionGroup("ItemDefinitionGroup");
+constexpr MsvsXmlName ItemGroup("ItemGroup");
+constexpr MsvsXmlName Label("Label");
+constexpr MsvsXmlName LanguageStandard("LanguageStandard");
+constexpr MsvsXmlName LanguageStandard_C("LanguageStandard_C");
+constexpr MsvsXmlName Link("Link");
+constexpr MsvsXmlName LocalDebuggerCommand("LocalDebuggerCommand");
+constexpr MsvsXmlName LocalDebuggerWorkingDirectory("LocalDebuggerWorkingDirectory");
+constexpr MsvsXmlName MakeDir("MakeDir");
+constexpr MsvsXmlName Message("Message");
+constexpr MsvsXmlName NMakeBuildCommandLine("NMakeBuildCommandLine");
+constexpr MsvsXmlName NMakeCleanCommandLine("NMakeCleanCommandLine");
+constexpr MsvsXmlName NMakeForcedIncludes("NMakeForcedIncludes");
+constexpr MsvsXmlName NMakeIncludeSearchPath("NMakeIncludeSearchPath");
+constexpr MsvsXmlName NMakeOutput("NMakeOutput");
+constexpr MsvsXmlName NMakePreprocessorDefinitions("NMakePreprocessorDefinitions");
+constexpr MsvsXmlName Name("Name");
+constexpr MsvsXmlName None("None");
+constexpr MsvsXmlName Optimization("Optimization");
+constexpr MsvsXmlName OptimizeReferences("OptimizeReferences");
+constexpr MsvsXmlName OutDir("OutDir");
+constexpr MsvsXmlName Outputs("Outputs");
+constexpr MsvsXmlName Platform("Platform");
+constexpr MsvsXmlName PlatformToolset("PlatformToolset");
+constexpr MsvsXmlName PrecompiledHeader("PrecompiledHeader");
+constexpr MsvsXmlName PrecompiledHeaderFile("PrecompiledHeaderFile");
+constexpr MsvsXmlName PreprocessorDefinitions("PreprocessorDefinitions");
+constexpr MsvsXmlName Project("Project");
+constexpr MsvsXmlName ProjectConfiguration("ProjectConfiguration");
+constexpr MsvsXmlName ProjectGuid("ProjectGuid");
+constexpr MsvsXmlName ProjectName("ProjectName");
+constexpr MsvsXmlName PropertyGroup("PropertyGroup");
+constexpr MsvsXmlName QbsJobs("QbsJobs");
+constexpr MsvsXmlName QbsJobsArgument("QbsJobsArgument");
+constexpr MsvsXmlName QbsRegenerateCommand("QbsRegenerateCommand");
+constexpr MsvsXmlName QbsRegenerateStamp("QbsRegenerateStamp");
+constexpr MsvsXmlName QbsUpToDateStamp("QbsUpToDateStamp");
+constexpr MsvsXmlName RuntimeLibrary("RuntimeLibrary");
+constexpr MsvsXmlName Target("Target");
+constexpr MsvsXmlName TargetName("TargetName");
+constexpr MsvsXmlName Text("Text");
+constexpr MsvsXmlName ToolsVersion("ToolsVersion");
+constexpr MsvsXmlName Touch("Touch");
+constexpr MsvsXmlName UniqueIdentifier("UniqueIdentifier");
+constexpr MsvsXmlName UpToDateCheckInput("UpToDateCheckInput");
+constexpr MsvsXmlName UpToDateCheckOutput("UpToDateCheckOutput");
+constexpr MsvsXmlName UseDebugLibraries("UseDebugLibraries");
+constexpr MsvsXmlName WarningLevel("WarningLevel");
+constexpr MsvsXmlName xmlns("xmlns");
+} // namespace MSBuildSchema
+
 static const QString kMSBuildSchemaURI = QStringLiteral("http://schemas.microsoft.com/developer/msbuild/2003");
 
+// Converts an MSVC /std: switch value into the MSBuild LanguageStandard(_C) value.
+static QString msbuildLanguageStandard(const QString &stdSwitch)
+{
+    QString result = stdSwitch;
+    return QStringLiteral("std") + result.replace(QStringLiteral("c++"), QStringLiteral("cpp"));
+}
+
+// The value of a "set" line of the regeneration. Exec runs the lines from a batch file,
+// where "%" is doubled, and they pass an MSBuild property, where "%", "$" and "@" are
+// escaped as hexadecimal codes. Values with quotes or line breaks are rejected by the generator.
+static QString regenerateEnvironmentValue(const QString &value)
+{
+    QString result;
+    result.reserve(value.size());
+    for (const QChar c : value) {
+        if (c == QLatin1Char('%'))
+            result += QStringLiteral("%25%25");
+        else if (c == QLatin1Char('$'))
+            result += QStringLiteral("%24");
+        else if (c == QLatin1Char('@'))
+            result += QStringLiteral("%40");
+        else
+            result += c;
+    }
+    return result;
+}
+
+struct ItemTypeMapping
+{
+    QString fileTag;
+    QString itemType;
+    bool isQtItemType;
+};
+
+// The first entry matching any tag of a file wins, the item type of other files is "None".
+// The names are static string data, so looking up the item type of a file does not allocate.
+static const ItemTypeMapping kItemTypes[] = {
+    {QStringLiteral("cpp"), QStringLiteral("ClCompile"), false},
+    {QStringLiteral("c"), QStringLiteral("ClCompile"), false},
+    {QStringLiteral("hpp"), QStringLiteral("ClInclude"), false},
+    {QStringLiteral("cpp_pch_src"), QStringLiteral("ClInclude"), false},
+    {QStringLiteral("c_pch_src"), QStringLiteral("ClInclude"), false},
+    {QStringLiteral("rc"), QStringLiteral("ResourceCompile"), false},
+    {QStringLiteral("ui"), QStringLiteral("QtUic"), true},
+    {QStringLiteral("qrc"), QStringLiteral("QtRcc"), true},
+    {QStringLiteral("ts"), QStringLiteral("QtTranslation"), true}
+};
+
+static const QString kDefaultItemType = QStringLiteral("None");
+
+QString MSBuildProjectWriter::itemType(const QSet<QString> &fileTags) const
+{
+    for (const ItemTypeMapping &mapping : kItemTypes) {
+        if ((!mapping.isQtItemType || m_options.qtItemTypes) && fileTags.contains(mapping.fileTag))
+            return mapping.itemType;
+    }
+    return kDefaultItemType;
+}
+
+QStringList MSBuildProjectWriter::itemTypes() const
+{
+    QStringList result;
+    for (const ItemTypeMapping &mapping : kItemTypes) {
+        if (!mapping.isQtItemType || m_options.qtItemTypes)
+            result << mapping.itemType;
+    }
+    result << kDefaultItemType;
+    result.removeDuplicates();
+    return result;
+}
+
 bool MSBuildProjectWriter::writeProjectFile(const MsvsPreparedProduct &product,
                                             const QString &baseBuildDirectory) const
 {
@@ -50,33 +207,40 @@ QString MSBuildProjectWriter::projectFileExtension() const
     return QStringLiteral(".vcxproj");
 }
 
+QStringList MSBuildProjectWriter::outputFilePaths(const MsvsPreparedProduct &product,
+                                                  const QString &baseBuildDirectory) const
+{
+    const QString projectFilePath = targetFilePath(product, baseBuildDirectory);
+    return QStringList() << projectFilePath << projectFilePath + QStringLiteral(".filters");
+}
+
 bool MSBuildProjectWriter::writeFiltersFile(const MsvsPreparedProduct &product,
                                             const QString &baseBuildDirectory) const
 {
-    QFile file(targetFilePath(product, baseBuildDirectory) + QStringLiteral(".filters"));
-    if (!file.open(QIODevice::WriteOnly))
-        return false;
+    const QString projectFilePath = targetFilePath(product, baseBuildDirectory);
+    const QString projectDirectory = QFileInfo(projectFilePath).path();
 
-    QXmlStreamWriter xmlWriter(&file);
+    MsvsRenderBuffer buffer;
+    MsvsXmlWriter xmlWriter(buffer.device());
     xmlWriter.setAutoFormatting(true);
 
     xmlWriter.writeStartDocument();
-    xmlWriter.writeStartElement(QStringLiteral("Project"));
-    xmlWriter.writeAttribute(QStringLiteral("ToolsVersion"), m_versionInfo.toolsVersion());
-    xmlWriter.writeAttribute(QStringLiteral("xmlns"), kMSBuildSchemaURI);
+    xmlWriter.writeStartElement(MSBuildSchema::Project);
+    xmlWriter.writeAttribute(MSBuildSchema::ToolsVersion, m_versionInfo.toolsVersion());
+    xmlWriter.writeAttribute(MSBuildSchema::xmlns, kMSBuildSchemaURI);
 
     foreach (const VisualStudioItemGroupFilter &options, m_filterOptions) {
-        xmlWriter.writeStartElement(QStringLiteral("ItemGroup"));
-        xmlWriter.writeAttribute(QStringLiteral("Label"), QStringLiteral("ProjectConfigurations"));
+        xmlWriter.writeStartElement(MSBuildSchema::ItemGroup);
+        xmlWriter.writeAttribute(MSBuildSchema::Label, QStringLiteral("ProjectConfigurations"));
 
-            xmlWriter.writeStartElement(QStringLiteral("Filter"));
-            xmlWriter.writeAttribute(QStringLiteral("Include"), options.title);
+            xmlWriter.writeStartElement(MSBuildSchema::Filter);
+            xmlWriter.writeAttribute(MSBuildSchema::Include, options.title);
 
-                xmlWriter.writeStartElement(QStringLiteral("UniqueIdentifier"));
-                xmlWriter.writeCharacters(QUuid::createUuid().toString());
+                xmlWriter.writeStartElement(MSBuildSchema::UniqueIdentifier);
+                xmlWriter.writeCharacters(MsvsPreparedProject::createGuid(QStringLiteral("filter:") + options.title));
                 xmlWriter.writeEndElement();
 
-                xmlWriter.writeStartElement(QStringLiteral("Extensions"));
+                xmlWriter.writeStartElement(MSBuildSchema::Extensions);
                 xmlWriter.writeCharacters(options.extensions.toList().join(Internal::HostOsInfo::pathListSeparator(Internal::HostOsInfo::HostOsWindows)));
                 xmlWriter.writeEndElement();
 
@@ -91,126 +255,396 @@ bool MSBuildProjectWriter::writeFiltersFile(const MsvsPreparedProduct &product,
         xmlWriter.writeEndElement();
     }
 
-    xmlWriter.writeStartElement(QStringLiteral("ItemGroup"));
-    QSet<QString> allFiles;
+    xmlWriter.writeStartElement(MSBuildSchema::ItemGroup);
+    ProjectFileTags allFileTags;
 
     foreach (const MsvsProjectConfiguration &buildTask, product.configurations.keys())
         foreach (const GroupData &groupData, product.configurations[buildTask].groups())
             if (groupData.isEnabled())
-                allFiles.unite(groupData.allFilePaths().toSet());
+                foreach (const ArtifactData &artifact, groupData.allSourceArtifacts())
+                    allFileTags[projectPath(artifact.filePath(), projectDirectory)].unite(artifact.fileTags().toSet());
 
-    foreach (const QString& fileName, allFiles) {
-        xmlWriter.writeStartElement(QStringLiteral("ClCompile"));
+    QStringList fileNames = allFileTags.keys();
+    fileNames.sort();
 
-            xmlWriter.writeAttribute(QStringLiteral("Include"), fileName);
-            xmlWriter.writeStartElement(QStringLiteral("Filter"));
-            // TODO: can we get file tags here from GroupData?
-            foreach (const VisualStudioItemGroupFilter &options, m_filterOptions) // FIXME: non-optimal algorithm. Fix on bad performance.
-                if (options.matchesFilter(fileName))
-                    xmlWriter.writeCharacters(options.title);
+    MsvsMemoryAccounting &memoryAccounting = MsvsMemoryAccounting::instance();
+    if (memoryAccounting.isEnabled())
+        memoryAccounting.record(QStringLiteral("filters file set"), MsvsMemoryAccounting::sizeOf(fileNames), fileNames.size());
 
-            xmlWriter.writeEndElement();
+    writeElements(xmlWriter, fileNames.size(), [&](MsvsXmlWriter &itemWriter, int index) {
+        const QString &fileName = fileNames.at(index);
+        QString fileFilter;
+        for (const VisualStudioItemGroupFilter &options : m_filterOptions)
+            if (options.matchesFilter(fileName))
+                fileFilter += options.title;
+
+        itemWriter.writeStartElement(itemType(allFileTags.value(fileName)));
+
+            itemWriter.writeAttribute(MSBuildSchema::Include, fileName);
+            itemWriter.writeTextElement(MSBuildSchema::Filter, fileFilter);
+
+        itemWriter.writeEndElement();
+    });
+
+    xmlWriter.writeEndElement();
+
+    xmlWriter.writeEndDocument();
+
+    if (xmlWriter.hasError())
+        return false;
+    if (memoryAccounting.isEnabled())
+        memoryAccounting.record(QStringLiteral("rendered filters buffers"), buffer.size(), 1);
+
+    MsvsStatistics::instance().recordRendered(buffer.size());
+    return MsvsStagedOutput::instance().writeFile(projectFilePath + QStringLiteral(".filters"), buffer.data());
+}
+
+QString MSBuildProjectWriter::regenerateProjectFilePath(const MsvsRegenerateProject &regenerateProject,
+                                                        const QString &baseBuildDirectory) const
+{
+    return QDir(baseBuildDirectory).absoluteFilePath(regenerateProject.name + projectFileExtension());
+}
+
+// The regeneration runs as an MSBuild target with inputs and outputs,
+// so it is skipped without starting any process while the stamp is up to date.
+bool MSBuildProjectWriter::writeRegenerateProjectFile(const MsvsPreparedProject &project,
+                                                      const MsvsRegenerateProject &regenerateProject,
+                                                      const QString &baseBuildDirectory) const
+{
+    QBS_CHECK(!project.enabledConfigurations.isEmpty());
+    const QString projectFilePath = regenerateProjectFilePath(regenerateProject, baseBuildDirectory);
+    const QString projectDirectory = QFileInfo(projectFilePath).path();
+    const MsvsProjectConfiguration &firstConfiguration = project.enabledConfigurations.first();
+
+    QStringList commandLineArgs = QStringList()
+            << QStringLiteral("generate")
+            << QStringLiteral("-g") << regenerateProject.generatorName
+            << QStringLiteral("-f") << QDir::toNativeSeparators(projectPath(firstConfiguration.qbsProjectFile, projectDirectory))
+            << QStringLiteral("-d") << QDir::toNativeSeparators(projectPath(firstConfiguration.buildDirectory, projectDirectory));
+    if (!firstConfiguration.installRoot.isEmpty())
+        commandLineArgs << QStringLiteral("--install-root")
+                        << QDir::toNativeSeparators(projectPath(firstConfiguration.installRoot, projectDirectory));
+    for (const MsvsProjectConfiguration &buildTask : project.enabledConfigurations)
+        commandLineArgs << buildTask.variant << QStringLiteral("profile:") + buildTask.profile
+                        << buildTask.commandLineParameters;
+
+    QStringList commandLines;
+    for (auto it = regenerateProject.environment.cbegin(); it != regenerateProject.environment.cend(); ++it)
+        commandLines << QStringLiteral("set \"%1=%2\"").arg(it.key(), regenerateEnvironmentValue(it.value()));
+    commandLines << Internal::shellQuote(QDir::toNativeSeparators(projectPath(firstConfiguration.qbsExecutablePath, projectDirectory)),
+                                         commandLineArgs, Internal::HostOsInfo::HostOsWindows);
+
+    MsvsRenderBuffer buffer;
+    MsvsXmlWriter xmlWriter(buffer.device());
+    xmlWriter.setAutoFormatting(true);
+
+    xmlWriter.writeStartDocument();
+    xmlWriter.writeStartElement(MSBuildSchema::Project);
+    xmlWriter.writeAttribute(MSBuildSchema::DefaultTargets, QStringLiteral("Build"));
+    xmlWriter.writeAttribute(MSBuildSchema::ToolsVersion, m_versionInfo.toolsVersion());
+    xmlWriter.writeAttribute(MSBuildSchema::xmlns, kMSBuildSchemaURI);
+
+    xmlWriter.writeStartElement(MSBuildSchema::ItemGroup);
+    xmlWriter.writeAttribute(MSBuildSchema::Label, QStringLiteral("ProjectConfigurations"));
+    for (const MsvsProjectConfiguration &buildTask : project.enabledConfigurations) {
+        xmlWriter.writeStartElement(MSBuildSchema::ProjectConfiguration);
+        xmlWriter.writeAttribute(MSBuildSchema::Include, buildTask.fullName());
+        xmlWriter.writeTextElement(MSBuildSchema::Configuration, buildTask.profileAndVariant());
+        xmlWriter.writeTextElement(MSBuildSchema::Platform, buildTask.platform);
+        xmlWriter.writeEndElement();
+    }
+    xmlWriter.writeEndElement();
+
+    xmlWriter.writeStartElement(MSBuildSchema::PropertyGroup);
+    xmlWriter.writeAttribute(MSBuildSchema::Label, QStringLiteral("Globals"));
+    xmlWriter.writeTextElement(MSBuildSchema::ProjectGuid, regenerateProject.guid);
+    xmlWriter.writeTextElement(MSBuildSchema::ProjectName, regenerateProject.name);
+    xmlWriter.writeEndElement();
+
+    xmlWriter.writeStartElement(MSBuildSchema::Import);
+    xmlWriter.writeAttribute(MSBuildSchema::Project,
+                             QStringLiteral("$(VCTargetsPath)\\Microsoft.Cpp.Default.props"));
+    xmlWriter.writeEndElement();
+
+    xmlWriter.writeStartElement(MSBuildSchema::PropertyGroup);
+    xmlWriter.writeAttribute(MSBuildSchema::Label, QStringLiteral("Configuration"));
+    xmlWriter.writeTextElement(MSBuildSchema::ConfigurationType, QStringLiteral("Utility"));
+    xmlWriter.writeTextElement(MSBuildSchema::PlatformToolset, m_versionInfo.platformToolsetVersion());
+    xmlWriter.writeEndElement();
+
+    xmlWriter.writeStartElement(MSBuildSchema::Import);
+    xmlWriter.writeAttribute(MSBuildSchema::Project,
+                             QStringLiteral("$(VCTargetsPath)\\Microsoft.Cpp.props"));
+    xmlWriter.writeEndElement();
+
+    xmlWriter.writeStartElement(MSBuildSchema::PropertyGroup);
+    xmlWriter.writeTextElement(MSBuildSchema::QbsRegenerateStamp, projectPath(regenerateProject.stampFilePath, projectDirectory));
+    xmlWriter.writeTextElement(MSBuildSchema::QbsRegenerateCommand, commandLines.join(QLatin1Char('\n')));
+    xmlWriter.writeEndElement();
+
+    xmlWriter.writeStartElement(MSBuildSchema::ItemGroup);
+    for (const QString &filePath : regenerateProject.buildSystemFiles) {
+        xmlWriter.writeStartElement(MSBuildSchema::None);
+        xmlWriter.writeAttribute(MSBuildSchema::Include, projectPath(filePath, projectDirectory));
+        xmlWriter.writeEndElement();
+    }
+    xmlWriter.writeEndElement();
+
+    xmlWriter.writeStartElement(MSBuildSchema::Import);
+    xmlWriter.writeAttribute(MSBuildSchema::Project, QStringLiteral("$(VCTargetsPath)\\Microsoft.Cpp.targets"));
+    xmlWriter.writeEndElement();
+
+    xmlWriter.writeStartElement(MSBuildSchema::Target);
+    xmlWriter.writeAttribute(MSBuildSchema::Name, QStringLiteral("QbsRegenerate"));
+    xmlWriter.writeAttribute(MSBuildSchema::BeforeTargets, QStringLiteral("Build"));
+    xmlWriter.writeAttribute(MSBuildSchema::Inputs, QStringLiteral("@(None)"));
+    xmlWriter.writeAttribute(MSBuildSchema::Outputs, QStringLiteral("$(QbsRegenerateStamp)"));
+        xmlWriter.writeStartElement(MSBuildSchema::Message);
+        xmlWriter.writeAttribute(MSBuildSchema::Importance, QStringLiteral("high"));
+        xmlWriter.writeAttribute(MSBuildSchema::Text, QStringLiteral("qbs files changed, regenerating the solution"));
+        xmlWriter.writeEndElement();
 
+        xmlWriter.writeStartElement(MSBuildSchema::Exec);
+        xmlWriter.writeAttribute(MSBuildSchema::Command, QStringLiteral("$(QbsRegenerateCommand)"));
+        xmlWriter.writeEndElement();
+
+        xmlWriter.writeStartElement(MSBuildSchema::Touch);
+        xmlWriter.writeAttribute(MSBuildSchema::Files, QStringLiteral("$(QbsRegenerateStamp)"));
+        xmlWriter.writeAttribute(MSBuildSchema::AlwaysCreate, QStringLiteral("true"));
+        xmlWriter.writeEndElement();
+    xmlWriter.writeEndElement();
+
+    xmlWriter.writeEndElement(); // </Project>
+    xmlWriter.writeEndDocument();
+
+    return !xmlWriter.hasError()
+            && MsvsStagedOutput::instance().writeFile(projectFilePath, buffer.data());
+}
+
+QString MSBuildProjectWriter::batchBuildProjectFilePath(const MsvsBatchBuildProject &batchBuildProject,
+                                                        const QString &baseBuildDirectory) const
+{
+    return QDir(baseBuildDirectory).absoluteFilePath(batchBuildProject.name + projectFileExtension());
+}
+
+// One qbs process builds the whole configuration matrix with a single job pool,
+// where a batch build in Visual Studio would run the products one by one.
+bool MSBuildProjectWriter::writeBatchBuildProjectFile(const MsvsPreparedProject &project,
+                                                      const MsvsBatchBuildProject &batchBuildProject,
+                                                      const QString &baseBuildDirectory) const
+{
+    QBS_CHECK(!project.enabledConfigurations.isEmpty());
+    const QString projectFilePath = batchBuildProjectFilePath(batchBuildProject, baseBuildDirectory);
+    const QString projectDirectory = QFileInfo(projectFilePath).path();
+    const QString buildSubCommand = project.enabledConfigurations.first().buildSubCommand();
+
+    MsvsRenderBuffer buffer;
+    MsvsXmlWriter xmlWriter(buffer.device());
+    xmlWriter.setAutoFormatting(true);
+
+    xmlWriter.writeStartDocument();
+    xmlWriter.writeStartElement(MSBuildSchema::Project);
+    xmlWriter.writeAttribute(MSBuildSchema::DefaultTargets, QStringLiteral("Build"));
+    xmlWriter.writeAttribute(MSBuildSchema::ToolsVersion, m_versionInfo.toolsVersion());
+    xmlWriter.writeAttribute(MSBuildSchema::xmlns, kMSBuildSchemaURI);
+
+    xmlWriter.writeStartElement(MSBuildSchema::ItemGroup);
+    xmlWriter.writeAttribute(MSBuildSchema::Label, QStringLiteral("ProjectConfigurations"));
+    for (const MsvsProjectConfiguration &buildTask : project.enabledConfigurations) {
+        xmlWriter.writeStartElement(MSBuildSchema::ProjectConfiguration);
+        xmlWriter.writeAttribute(MSBuildSchema::Include, buildTask.fullName());
+        xmlWriter.writeTextElement(MSBuildSchema::Configuration, buildTask.profileAndVariant());
+        xmlWriter.writeTextElement(MSBuildSchema::Platform, buildTask.platform);
         xmlWriter.writeEndElement();
     }
+    xmlWriter.writeEndElement();
+
+    xmlWriter.writeStartElement(MSBuildSchema::PropertyGroup);
+    xmlWriter.writeAttribute(MSBuildSchema::Label, QStringLiteral("Globals"));
+    xmlWriter.writeTextElement(MSBuildSchema::ProjectGuid, batchBuildProject.guid);
+    xmlWriter.writeTextElement(MSBuildSchema::ProjectName, batchBuildProject.name);
+    xmlWriter.writeEndElement();
+
+    xmlWriter.writeStartElement(MSBuildSchema::Import);
+    xmlWriter.writeAttribute(MSBuildSchema::Project,
+                             QStringLiteral("$(VCTargetsPath)\\Microsoft.Cpp.Default.props"));
+    xmlWriter.writeEndElement();
+
+    xmlWriter.writeStartElement(MSBuildSchema::PropertyGroup);
+    xmlWriter.writeAttribute(MSBuildSchema::Label, QStringLiteral("Configuration"));
+    xmlWriter.writeTextElement(MSBuildSchema::ConfigurationType, QStringLiteral("Makefile"));
+    xmlWriter.writeTextElement(MSBuildSchema::PlatformToolset, m_versionInfo.platformToolsetVersion());
+    xmlWriter.writeEndElement();
+
+    xmlWriter.writeStartElement(MSBuildSchema::Import);
+    xmlWriter.writeAttribute(MSBuildSchema::Project,
+                             QStringLiteral("$(VCTargetsPath)\\Microsoft.Cpp.props"));
+    xmlWriter.writeEndElement();
+
+    writeJobCountProperties(xmlWriter);
+
+    // The same commands in every solution configuration.
+    xmlWriter.writeStartElement(MSBuildSchema::PropertyGroup);
+    xmlWriter.writeTextElement(MSBuildSchema::NMakeBuildCommandLine,
+                               qbsCommandLine(buildSubCommand, QString(), project.enabledConfigurations, projectDirectory));
+    xmlWriter.writeTextElement(MSBuildSchema::NMakeCleanCommandLine,
+                               qbsCommandLine(QStringLiteral("clean"), QString(), project.enabledConfigurations, projectDirectory));
+    xmlWriter.writeEndElement();
 
+    xmlWriter.writeStartElement(MSBuildSchema::Import);
+    xmlWriter.writeAttribute(MSBuildSchema::Project, QStringLiteral("$(VCTargetsPath)\\Microsoft.Cpp.targets"));
     xmlWriter.writeEndElement();
 
+    xmlWriter.writeEndElement(); // </Project>
     xmlWriter.writeEndDocument();
 
-    return !xmlWriter.hasError() && file.flush();
+    return !xmlWriter.hasError()
+            && MsvsStagedOutput::instance().writeFile(projectFilePath, buffer.data());
+}
+
+QString MSBuildProjectWriter::jobCountArgument() const
+{
+    return QStringLiteral("$(QbsJobsArgument)");
+}
+
+// QbsJobs is empty unless set by the generator or on the MSBuild command line,
+// and the job count is then left to qbs.
+void MSBuildProjectWriter::writeJobCountProperties(MsvsXmlWriter &xmlWriter) const
+{
+    xmlWriter.writeStartElement(MSBuildSchema::PropertyGroup);
+    xmlWriter.writeAttribute(MSBuildSchema::Label, QStringLiteral("QbsJobs"));
+    if (!m_options.jobs.isEmpty()) {
+        xmlWriter.writeStartElement(MSBuildSchema::QbsJobs);
+        xmlWriter.writeAttribute(MSBuildSchema::Condition, QStringLiteral("'$(QbsJobs)'==''"));
+        xmlWriter.writeCharacters(m_options.jobs);
+        xmlWriter.writeEndElement();
+    } else if (m_options.jobPoolSize > 0) {
+        xmlWriter.writeStartElement(MSBuildSchema::QbsJobs);
+        xmlWriter.writeAttribute(MSBuildSchema::Condition, QStringLiteral("'$(QbsJobs)'==''"));
+        xmlWriter.writeCharacters(QStringLiteral("$([System.Math]::Floor($([MSBuild]::Divide($(NUMBER_OF_PROCESSORS), %1))))")
+                                  .arg(m_options.jobPoolSize));
+        xmlWriter.writeEndElement();
+        xmlWriter.writeStartElement(MSBuildSchema::QbsJobs);
+        xmlWriter.writeAttribute(MSBuildSchema::Condition, QStringLiteral("'$(QbsJobs)'=='0'"));
+        xmlWriter.writeCharacters(QStringLiteral("1"));
+        xmlWriter.writeEndElement();
+    }
+    xmlWriter.writeStartElement(MSBuildSchema::QbsJobsArgument);
+    xmlWriter.writeAttribute(MSBuildSchema::Condition, QStringLiteral("'$(QbsJobs)'!=''"));
+    xmlWriter.writeCharacters(QStringLiteral("-j $(QbsJobs)"));
+    xmlWriter.writeEndElement();
+    xmlWriter.writeEndElement();
 }
 
-void MSBuildProjectWriter::writeHeader(QXmlStreamWriter &xmlWriter,
+void MSBuildProjectWriter::writeHeader(MsvsXmlWriter &xmlWriter,
                                        const MsvsPreparedProduct &product) const
 {
     xmlWriter.writeStartDocument();
 
-    xmlWriter.writeStartElement(QStringLiteral("Project"));
-    xmlWriter.writeAttribute(QStringLiteral("DefaultTargets"), QStringLiteral("Build"));
-    xmlWriter.writeAttribute(QStringLiteral("ToolsVersion"), m_versionInfo.toolsVersion());
-    xmlWriter.writeAttribute(QStringLiteral("xmlns"), kMSBuildSchemaURI);
+    xmlWriter.writeStartElement(MSBuildSchema::Project);
+    xmlWriter.writeAttribute(MSBuildSchema::DefaultTargets, QStringLiteral("Build"));
+    xmlWriter.writeAttribute(MSBuildSchema::ToolsVersion, m_versionInfo.toolsVersion());
+    xmlWriter.writeAttribute(MSBuildSchema::xmlns, kMSBuildSchemaURI);
 
     // Project begin
-    xmlWriter.writeStartElement(QStringLiteral("ItemGroup"));
-    xmlWriter.writeAttribute(QStringLiteral("Label"), QStringLiteral("ProjectConfigurations"));
+    xmlWriter.writeStartElement(MSBuildSchema::ItemGroup);
+    xmlWriter.writeAttribute(MSBuildSchema::Label, QStringLiteral("ProjectConfigurations"));
     foreach (const MsvsProjectConfiguration &buildTask, product.configurations.keys()) {
-        xmlWriter.writeStartElement(QStringLiteral("ProjectConfiguration"));
-        xmlWriter.writeAttribute(QStringLiteral("Include"), buildTask.fullName());
-        xmlWriter.writeTextElement(QStringLiteral("Configuration"), buildTask.profileAndVariant());
-        xmlWriter.writeTextElement(QStringLiteral("Platform"), buildTask.platform);
+        xmlWriter.writeStartElement(MSBuildSchema::ProjectConfiguration);
+        xmlWriter.writeAttribute(MSBuildSchema::Include, buildTask.fullName());
+        xmlWriter.writeTextElement(MSBuildSchema::Configuration, buildTask.profileAndVariant());
+        xmlWriter.writeTextElement(MSBuildSchema::Platform, buildTask.platform);
         xmlWriter.writeEndElement();
     }
     xmlWriter.writeEndElement();
 
-    xmlWriter.writeStartElement(QStringLiteral("PropertyGroup"));
-    xmlWriter.writeAttribute(QStringLiteral("Label"), QStringLiteral("Globals"));
-    xmlWriter.writeTextElement(QStringLiteral("ProjectGuid"), product.guid);
+    xmlWriter.writeStartElement(MSBuildSchema::PropertyGroup);
+    xmlWriter.writeAttribute(MSBuildSchema::Label, QStringLiteral("Globals"));
+    xmlWriter.writeTextElement(MSBuildSchema::ProjectGuid, product.guid);
     xmlWriter.writeEndElement();
 
-    xmlWriter.writeStartElement(QStringLiteral("Import"));
-    xmlWriter.writeAttribute(QStringLiteral("Project"),
+    xmlWriter.writeStartElement(MSBuildSchema::Import);
+    xmlWriter.writeAttribute(MSBuildSchema::Project,
                              QStringLiteral("$(VCTargetsPath)\\Microsoft.Cpp.Default.props"));
     xmlWriter.writeEndElement();
 
-    xmlWriter.writeStartElement(QStringLiteral("Import"));
-    xmlWriter.writeAttribute(QStringLiteral("Project"),
+    xmlWriter.writeStartElement(MSBuildSchema::Import);
+    xmlWriter.writeAttribute(MSBuildSchema::Project,
                              QStringLiteral("$(VCTargetsPath)\\Microsoft.Cpp.props"));
     xmlWriter.writeEndElement();
+
+    writeJobCountProperties(xmlWriter);
 }
 
-void MSBuildProjectWriter::writeConfiguration(QXmlStreamWriter &xmlWriter,
+void MSBuildProjectWriter::writeConfiguration(MsvsXmlWriter &xmlWriter,
                                                  const MsvsPreparedProduct &product,
                                                  const MsvsProjectConfiguration &buildTask,
-                                                 const ProductData &productData) const
+                                                 const ProductData &productData,
+                                                 const QString &projectDirectory) const
 {
-    const QString targetDir = product.targetPath;
+    const MsvsProductProperties &properties = product.propertiesFor(buildTask);
 
-    const PropertyMap properties = productData.moduleProperties();
+    const QString targetDir = projectDirectoryPath(properties.targetPath, projectDirectory);
 
-    const bool debugBuild = properties.getModuleProperty(QStringLiteral("qbs"), QStringLiteral("debugInformation")).toBool();
+    const bool debugBuild = properties.debugInformation;
 
     const QString buildTaskCondition = QStringLiteral("'$(Configuration)|$(Platform)'=='") + buildTask.fullName() + QStringLiteral("'");
-    const QString optimizationLevel = properties.getModuleProperty(QStringLiteral("qbs"), QStringLiteral("optimization")).toString();
-    const QString warningLevel = properties.getModuleProperty(QStringLiteral("qbs"), QStringLiteral("warningLevel")).toString();
-
-    const QStringList includePaths = QStringList()
-            << properties.getModulePropertiesAsStringList(QStringLiteral("cpp"), QStringLiteral("includePaths"))
-            << properties.getModulePropertiesAsStringList(QStringLiteral("cpp"), QStringLiteral("systemIncludePaths"));
-    const QStringList cppDefines = properties.getModulePropertiesAsStringList(QStringLiteral("cpp"), QStringLiteral("defines"));
+    const QString &optimizationLevel = properties.optimization;
+    const QString &warningLevel = properties.warningLevel;
+
+    const QStringList includePaths = projectPaths(properties.allIncludePaths, projectDirectory);
+    const QStringList &cppDefines = properties.defines;
+    const QStringList forcedIncludes = projectPaths(properties.forcedIncludes, projectDirectory);
+
+    // NMake projects feed IntelliSense from "AdditionalOptions" only, so the standard goes there too.
+    QStringList intelliSenseOptions;
+    if (!properties.cxxStandard.isEmpty())
+        intelliSenseOptions << QStringLiteral("/std:") + properties.cxxStandard;
+    intelliSenseOptions << properties.additionalCompilerOptions;
+
+    // LanguageStandard is known to the VS 2017 toolset and newer only, LanguageStandard_C
+    // to VS 2019 16.8 and newer.
+    const auto toolsetVersion = m_versionInfo.version();
+    const bool hasLanguageStandard = toolsetVersion.majorVersion() >= 15;
+    const bool hasCLanguageStandard = toolsetVersion.majorVersion() > 16
+            || (toolsetVersion.majorVersion() == 16 && toolsetVersion.minorVersion() >= 8);
 
     const auto sep = Internal::HostOsInfo::pathListSeparator(Internal::HostOsInfo::HostOsWindows);
 
     // Setup VCTool compilation option if someone wants to change configuration type.
-    xmlWriter.writeStartElement(QStringLiteral("PropertyGroup"));
-    xmlWriter.writeAttribute(QStringLiteral("Condition"), buildTaskCondition);
-    xmlWriter.writeAttribute(QStringLiteral("Label"), QStringLiteral("Configuration"));
-    xmlWriter.writeTextElement(QStringLiteral("ConfigurationType"), QStringLiteral("Makefile"));
-    xmlWriter.writeTextElement(QStringLiteral("UseDebugLibraries"), debugBuild ? QStringLiteral("true") : QStringLiteral("false"));
-    xmlWriter.writeTextElement(QStringLiteral("CharacterSet"), // VS possible values: Unicode|MultiByte|NotSet
-                               properties.getModuleProperty(QStringLiteral("cpp"), QStringLiteral("windowsApiCharacterSet")) == QStringLiteral("unicode") ? QStringLiteral("MultiByte") : QStringLiteral("NotSet"));
-    xmlWriter.writeTextElement(QStringLiteral("PlatformToolset"), m_versionInfo.platformToolsetVersion());
+    xmlWriter.writeStartElement(MSBuildSchema::PropertyGroup);
+    xmlWriter.writeAttribute(MSBuildSchema::Condition, buildTaskCondition);
+    xmlWriter.writeAttribute(MSBuildSchema::Label, QStringLiteral("Configuration"));
+    xmlWriter.writeTextElement(MSBuildSchema::ConfigurationType, QStringLiteral("Makefile"));
+    xmlWriter.writeTextElement(MSBuildSchema::UseDebugLibraries, debugBuild ? QStringLiteral("true") : QStringLiteral("false"));
+    xmlWriter.writeTextElement(MSBuildSchema::CharacterSet, // VS possible values: Unicode|MultiByte|NotSet
+                               properties.windowsApiCharacterSet == QStringLiteral("unicode") ? QStringLiteral("MultiByte") : QStringLiteral("NotSet"));
+    xmlWriter.writeTextElement(MSBuildSchema::PlatformToolset, m_versionInfo.platformToolsetVersion());
     xmlWriter.writeEndElement();
 
-    xmlWriter.writeStartElement(QStringLiteral("PropertyGroup"));
-    xmlWriter.writeAttribute(QStringLiteral("Condition"), buildTaskCondition);
-    xmlWriter.writeAttribute(QStringLiteral("Label"), QStringLiteral("Configuration"));
-    xmlWriter.writeTextElement(QStringLiteral("NMakeIncludeSearchPath"), includePaths.join(sep));
-    xmlWriter.writeTextElement(QStringLiteral("NMakePreprocessorDefinitions"), cppDefines.join(sep));
-    xmlWriter.writeTextElement(QStringLiteral("OutDir"), targetDir);
-    xmlWriter.writeTextElement(QStringLiteral("TargetName"), productData.targetName());
-    xmlWriter.writeTextElement(QStringLiteral("NMakeOutput"), QStringLiteral("$(OutDir)$(TargetName)$(TargetExt)"));
-    xmlWriter.writeTextElement(QStringLiteral("LocalDebuggerCommand"), QStringLiteral("$(OutDir)$(TargetName)$(TargetExt)"));
-    xmlWriter.writeTextElement(QStringLiteral("LocalDebuggerWorkingDirectory"), QStringLiteral("$(OutDir)"));
-    xmlWriter.writeTextElement(QStringLiteral("DebuggerFlavor"), QStringLiteral("WindowsLocalDebugger"));
-    xmlWriter.writeTextElement(QStringLiteral("NMakeBuildCommandLine"), qbsCommandLine(QStringLiteral("install"), product, buildTask));
-    xmlWriter.writeTextElement(QStringLiteral("NMakeCleanCommandLine"), qbsCommandLine(QStringLiteral("clean"), product, buildTask));
+    xmlWriter.writeStartElement(MSBuildSchema::PropertyGroup);
+    xmlWriter.writeAttribute(MSBuildSchema::Condition, buildTaskCondition);
+    xmlWriter.writeAttribute(MSBuildSchema::Label, QStringLiteral("Configuration"));
+    xmlWriter.writeTextElement(MSBuildSchema::NMakeIncludeSearchPath, includePaths.join(sep));
+    xmlWriter.writeTextElement(MSBuildSchema::NMakePreprocessorDefinitions, cppDefines.join(sep));
+    if (!forcedIncludes.isEmpty())
+        xmlWriter.writeTextElement(MSBuildSchema::NMakeForcedIncludes, forcedIncludes.join(sep));
+    if (!intelliSenseOptions.isEmpty())
+        xmlWriter.writeTextElement(MSBuildSchema::AdditionalOptions, intelliSenseOptions.join(QLatin1Char(' ')));
+    xmlWriter.writeTextElement(MSBuildSchema::OutDir, targetDir);
+    xmlWriter.writeTextElement(MSBuildSchema::TargetName, productData.targetName());
+    xmlWriter.writeTextElement(MSBuildSchema::NMakeOutput, QStringLiteral("$(OutDir)$(TargetName)$(TargetExt)"));
+    xmlWriter.writeTextElement(MSBuildSchema::LocalDebuggerCommand, QStringLiteral("$(OutDir)$(TargetName)$(TargetExt)"));
+    xmlWriter.writeTextElement(MSBuildSchema::LocalDebuggerWorkingDirectory, QStringLiteral("$(OutDir)"));
+    xmlWriter.writeTextElement(MSBuildSchema::DebuggerFlavor, QStringLiteral("WindowsLocalDebugger"));
+    xmlWriter.writeTextElement(MSBuildSchema::NMakeBuildCommandLine, qbsBuildCommandLine(product, buildTask, projectDirectory));
+    xmlWriter.writeTextElement(MSBuildSchema::NMakeCleanCommandLine, qbsCommandLine(QStringLiteral("clean"), product, buildTask, projectDirectory));
     xmlWriter.writeEndElement();
 
-    xmlWriter.writeStartElement(QStringLiteral("ItemDefinitionGroup"));
-    xmlWriter.writeAttribute(QStringLiteral("Condition"), buildTaskCondition);
-        xmlWriter.writeStartElement(QStringLiteral("ClCompile"));
-            xmlWriter.writeStartElement(QStringLiteral("WarningLevel"));
+    xmlWriter.writeStartElement(MSBuildSchema::ItemDefinitionGroup);
+    xmlWriter.writeAttribute(MSBuildSchema::Condition, buildTaskCondition);
+        xmlWriter.writeStartElement(MSBuildSchema::ClCompile);
+            xmlWriter.writeStartElement(MSBuildSchema::WarningLevel);
                 if (warningLevel == QStringLiteral("none"))
                     xmlWriter.writeCharacters(QStringLiteral("TurnOffAllWarnings"));
                 else if (warningLevel == QStringLiteral("all"))
@@ -219,52 +653,119 @@ void MSBuildProjectWriter::writeConfiguration(QXmlStreamWriter &xmlWriter,
                     xmlWriter.writeCharacters(QStringLiteral("Level3")); // this is VS default.
             xmlWriter.writeEndElement();
 
-            xmlWriter.writeTextElement(QStringLiteral("Optimization"), optimizationLevel == QStringLiteral("none") ? QStringLiteral("Disabled") : QStringLiteral("MaxSpeed"));
-            xmlWriter.writeTextElement(QStringLiteral("RuntimeLibrary"),
+            xmlWriter.writeTextElement(MSBuildSchema::Optimization, optimizationLevel == QStringLiteral("none") ? QStringLiteral("Disabled") : QStringLiteral("MaxSpeed"));
+            xmlWriter.writeTextElement(MSBuildSchema::RuntimeLibrary,
                                        debugBuild ? QStringLiteral("MultiThreadedDebugDLL") : QStringLiteral("MultiThreadedDLL"));
-            xmlWriter.writeTextElement(QStringLiteral("PreprocessorDefinitions"),
+            xmlWriter.writeTextElement(MSBuildSchema::PreprocessorDefinitions,
                                        cppDefines.join(sep) + sep + QStringLiteral("%(PreprocessorDefinitions)"));
-            xmlWriter.writeTextElement(QStringLiteral("AdditionalIncludeDirectories"),
+            xmlWriter.writeTextElement(MSBuildSchema::AdditionalIncludeDirectories,
                                        includePaths.join(sep) + sep + QStringLiteral("%(AdditionalIncludeDirectories)"));
+            if (!properties.precompiledHeaderFile.isEmpty()) {
+                xmlWriter.writeTextElement(MSBuildSchema::PrecompiledHeader, QStringLiteral("Use"));
+                xmlWriter.writeTextElement(MSBuildSchema::PrecompiledHeaderFile, properties.precompiledHeaderFile);
+            }
+            if (!forcedIncludes.isEmpty())
+                xmlWriter.writeTextElement(MSBuildSchema::ForcedIncludeFiles,
+                                           forcedIncludes.join(sep) + sep + QStringLiteral("%(ForcedIncludeFiles)"));
+            if (hasLanguageStandard && !properties.cxxStandard.isEmpty())
+                xmlWriter.writeTextElement(MSBuildSchema::LanguageStandard, msbuildLanguageStandard(properties.cxxStandard));
+            if (hasCLanguageStandard && !properties.cStandard.isEmpty())
+                xmlWriter.writeTextElement(MSBuildSchema::LanguageStandard_C, msbuildLanguageStandard(properties.cStandard));
         xmlWriter.writeEndElement();
 
-        xmlWriter.writeStartElement(QStringLiteral("Link"));
-            xmlWriter.writeTextElement(QStringLiteral("GenerateDebugInformation"), debugBuild ? QStringLiteral("true") : QStringLiteral("false"));
-            xmlWriter.writeTextElement(QStringLiteral("OptimizeReferences"), debugBuild ? QStringLiteral("false") : QStringLiteral("true"));
-            xmlWriter.writeTextElement(QStringLiteral("AdditionalDependencies"),
-                                       properties.getModulePropertiesAsStringList(QStringLiteral("cpp"), QStringLiteral("staticLibraries")).join(sep) + sep + QStringLiteral("%(AdditionalDependencies)"));
-            xmlWriter.writeTextElement(QStringLiteral("AdditionalLibraryDirectories"),
-                                       properties.getModulePropertiesAsStringList(QStringLiteral("cpp"), QStringLiteral("libraryPaths")).join(sep));
+        xmlWriter.writeStartElement(MSBuildSchema::Link);
+            xmlWriter.writeTextElement(MSBuildSchema::GenerateDebugInformation, debugBuild ? QStringLiteral("true") : QStringLiteral("false"));
+            xmlWriter.writeTextElement(MSBuildSchema::OptimizeReferences, debugBuild ? QStringLiteral("false") : QStringLiteral("true"));
+            xmlWriter.writeTextElement(MSBuildSchema::AdditionalDependencies,
+                                       projectPaths(properties.staticLibraries, projectDirectory).join(sep) + sep + QStringLiteral("%(AdditionalDependencies)"));
+            xmlWriter.writeTextElement(MSBuildSchema::AdditionalLibraryDirectories,
+                                       projectPaths(properties.libraryPaths, projectDirectory).join(sep));
         xmlWriter.writeEndElement();
         xmlWriter.writeEndElement();
 }
 
-void MSBuildProjectWriter::writeFiles(QXmlStreamWriter &xmlWriter,
+void MSBuildProjectWriter::writeFiles(MsvsXmlWriter &xmlWriter,
                                              const QSet<MsvsProjectConfiguration> &allConfigurations,
-                                             const ProjectConfigurations &allProjectFilesConfigurations) const
+                                             const ProjectConfigurations &allProjectFilesConfigurations,
+                                             const ProjectFileTags &allProjectFileTags) const
+{
+    xmlWriter.writeStartElement(MSBuildSchema::ItemGroup);
+
+    QHash<MsvsProjectConfiguration, QString> buildTaskConditions;
+    for (const MsvsProjectConfiguration &buildTask : allConfigurations)
+        buildTaskConditions.insert(buildTask, QStringLiteral("'$(Configuration)|$(Platform)'=='") + buildTask.fullName() + QStringLiteral("'"));
+
+    const QVector<ProjectFile> files = projectFiles(allConfigurations, allProjectFilesConfigurations, allProjectFileTags);
+    writeElements(xmlWriter, files.size(), [&](MsvsXmlWriter &itemWriter, int index) {
+        const ProjectFile &projectFile = files.at(index);
+        itemWriter.writeStartElement(itemType(projectFile.fileTags));
+        itemWriter.writeAttribute(MSBuildSchema::Include, projectFile.filePath);
+        for (const MsvsProjectConfiguration &buildTask : projectFile.disabledConfigurations) {
+            itemWriter.writeStartElement(MSBuildSchema::ExcludedFromBuild);
+            itemWriter.writeAttribute(MSBuildSchema::Condition, buildTaskConditions.value(buildTask));
+            itemWriter.writeCharacters(QStringLiteral("true"));
+            itemWriter.writeEndElement();
+        }
+        itemWriter.writeEndElement();
+    });
+    xmlWriter.writeEndElement();
+
+    xmlWriter.writeStartElement(MSBuildSchema::Import);
+    xmlWriter.writeAttribute(MSBuildSchema::Project, QStringLiteral("$(VCTargetsPath)\\Microsoft.Cpp.targets"));
+    xmlWriter.writeEndElement();
+}
+
+// The stamp is touched after every successful qbs build, and not the NMakeOutput target itself:
+// qbs does not relink a product whose qbs files changed without affecting its binary, which would
+// leave the target older than its inputs and the product out of date forever.
+void MSBuildProjectWriter::writeUpToDateCheck(MsvsXmlWriter &xmlWriter,
+                                              const MsvsPreparedProduct &product,
+                                              const QString &projectDirectory) const
 {
-    xmlWriter.writeStartElement(QStringLiteral("ItemGroup"));
-
-    foreach (const QString &filePath, allProjectFilesConfigurations.keys()) {
-        xmlWriter.writeStartElement(QStringLiteral("ClCompile"));
-        QSet<MsvsProjectConfiguration> disabledConfigurations = allConfigurations - allProjectFilesConfigurations[filePath];
-        xmlWriter.writeAttribute(QStringLiteral("Include"), filePath);
-        foreach (const MsvsProjectConfiguration &buildTask, disabledConfigurations) {
-            xmlWriter.writeStartElement(QStringLiteral("ExcludedFromBuild"));
-            xmlWriter.writeAttribute(QStringLiteral("Condition"), QStringLiteral("'$(Configuration)|$(Platform)'=='") + buildTask.fullName() + QStringLiteral("'"));
-            xmlWriter.writeCharacters(QStringLiteral("true"));
+    xmlWriter.writeStartElement(MSBuildSchema::PropertyGroup);
+    xmlWriter.writeTextElement(MSBuildSchema::QbsUpToDateStamp, QStringLiteral("$(IntDir)qbs.uptodate.stamp"));
+    xmlWriter.writeEndElement();
+
+    xmlWriter.writeStartElement(MSBuildSchema::ItemGroup);
+        xmlWriter.writeStartElement(MSBuildSchema::UpToDateCheckInput);
+        QStringList itemReferences;
+        for (const QString &type : itemTypes())
+            itemReferences << QStringLiteral("@(%1)").arg(type);
+        xmlWriter.writeAttribute(MSBuildSchema::Include, itemReferences.join(QLatin1Char(';')));
+        xmlWriter.writeEndElement();
+        for (const QString &filePath : product.buildSystemFiles) {
+            xmlWriter.writeStartElement(MSBuildSchema::UpToDateCheckInput);
+            xmlWriter.writeAttribute(MSBuildSchema::Include, projectPath(filePath, projectDirectory));
             xmlWriter.writeEndElement();
         }
+        xmlWriter.writeStartElement(MSBuildSchema::UpToDateCheckOutput);
+        xmlWriter.writeAttribute(MSBuildSchema::Include, QStringLiteral("$(QbsUpToDateStamp)"));
+        xmlWriter.writeEndElement();
+    xmlWriter.writeEndElement();
+
+    xmlWriter.writeStartElement(MSBuildSchema::Target);
+    xmlWriter.writeAttribute(MSBuildSchema::Name, QStringLiteral("QbsTouchUpToDateStamp"));
+    xmlWriter.writeAttribute(MSBuildSchema::AfterTargets, QStringLiteral("Build"));
+        xmlWriter.writeStartElement(MSBuildSchema::MakeDir);
+        xmlWriter.writeAttribute(MSBuildSchema::Directories, QStringLiteral("$(IntDir)"));
+        xmlWriter.writeEndElement();
+
+        xmlWriter.writeStartElement(MSBuildSchema::Touch);
+        xmlWriter.writeAttribute(MSBuildSchema::Files, QStringLiteral("$(QbsUpToDateStamp)"));
+        xmlWriter.writeAttribute(MSBuildSchema::AlwaysCreate, QStringLiteral("true"));
         xmlWriter.writeEndElement();
-    }
     xmlWriter.writeEndElement();
 
-    xmlWriter.writeStartElement(QStringLiteral("Import"));
-    xmlWriter.writeAttribute(QStringLiteral("Project"), QStringLiteral("$(VCTargetsPath)\\Microsoft.Cpp.targets"));
+    xmlWriter.writeStartElement(MSBuildSchema::Target);
+    xmlWriter.writeAttribute(MSBuildSchema::Name, QStringLiteral("QbsDeleteUpToDateStamp"));
+    xmlWriter.writeAttribute(MSBuildSchema::AfterTargets, QStringLiteral("Clean"));
+        xmlWriter.writeStartElement(MSBuildSchema::Delete);
+        xmlWriter.writeAttribute(MSBuildSchema::Files, QStringLiteral("$(QbsUpToDateStamp)"));
+        xmlWriter.writeEndElement();
     xmlWriter.writeEndElement();
 }
 
-void MSBuildProjectWriter::writeFooter(QXmlStreamWriter &xmlWriter) const
+void MSBuildProjectWriter::writeFooter(MsvsXmlWriter &xmlWriter) const
 {
     xmlWriter.writeEndElement(); // </Project>
     xmlWriter.writeEndDocument();
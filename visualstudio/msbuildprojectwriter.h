@@ -42,20 +42,44 @@ public:
     bool writeProjectFile(const MsvsPreparedProduct &product,
                           const QString &baseBuildDirectory) const override;
     QString projectFileExtension() const override;
+    QStringList outputFilePaths(const MsvsPreparedProduct &product,
+                                const QString &baseBuildDirectory) const override;
+
+    QString regenerateProjectFilePath(const MsvsRegenerateProject &regenerateProject,
+                                      const QString &baseBuildDirectory) const;
+    bool writeRegenerateProjectFile(const MsvsPreparedProject &project,
+                                    const MsvsRegenerateProject &regenerateProject,
+                                    const QString &baseBuildDirectory) const;
+
+    QString batchBuildProjectFilePath(const MsvsBatchBuildProject &batchBuildProject,
+                                      const QString &baseBuildDirectory) const;
+    bool writeBatchBuildProjectFile(const MsvsPreparedProject &project,
+                                    const MsvsBatchBuildProject &batchBuildProject,
+                                    const QString &baseBuildDirectory) const;
 
 protected:
     bool writeFiltersFile(const MsvsPreparedProduct &product,
                           const QString &baseBuildDirectory) const;
+    QString itemType(const QSet<QString> &fileTags) const;
+    QStringList itemTypes() const;
 
-    void writeHeader(QXmlStreamWriter &xmlWriter, const MsvsPreparedProduct &product) const override;
-    void writeConfiguration(QXmlStreamWriter &xmlWriter,
+    QString jobCountArgument() const override;
+    void writeJobCountProperties(MsvsXmlWriter &xmlWriter) const;
+
+    void writeHeader(MsvsXmlWriter &xmlWriter, const MsvsPreparedProduct &product) const override;
+    void writeConfiguration(MsvsXmlWriter &xmlWriter,
                             const MsvsPreparedProduct &product,
                             const MsvsProjectConfiguration &buildTask,
-                            const ProductData &productData) const override;
-    void writeFiles(QXmlStreamWriter &xmlWriter,
+                            const ProductData &productData,
+                            const QString &projectDirectory) const override;
+    void writeFiles(MsvsXmlWriter &xmlWriter,
                     const QSet<MsvsProjectConfiguration> &allConfigurations,
-                    const ProjectConfigurations &allProjectFilesConfigurations) const override;
-    void writeFooter(QXmlStreamWriter &xmlWriter) const override;
+                    const ProjectConfigurations &allProjectFilesConfigurations,
+                    const ProjectFileTags &allProjectFileTags) const override;
+    void writeUpToDateCheck(MsvsXmlWriter &xmlWriter,
+                            const MsvsPreparedProduct &product,
+                            const QString &projectDirectory) const override;
+    void writeFooter(MsvsXmlWriter &xmlWriter) const override;
 };
 
 }
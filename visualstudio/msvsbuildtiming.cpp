@@ -0,0 +1,154 @@
+/****************************************************************************
+**
+** Copyright (C) 2015 The Qt Company Ltd.
+** Contact: http://www.qt.io/licensing
+**
+** This file is part of the Qt Build Suite.
+**
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms and
+** conditions see http://www.qt.io/terms-conditions. For further information
+** use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file.  Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, The Qt Company gives you certain additional
+** rights.  These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+****************************************************************************/
+
+
+#include "msvsbuildtiming.h"
+#include "msvsstagedoutput.h"
+
+#include <tools/hostosinfo.h>
+#include <tools/shellutils.h>
+
+#include <QDir>
+
+namespace qbs {
+
+static const char kTimingScript[] = R"ps1(# Generated by qbs. Changes are overwritten by "qbs generate".
+# Runs the command line in QBS_MSVS_TIMING_COMMAND and appends its timing to qbs-build-timing.jsonl.
+# With -Summarize, aggregates that log into qbs-build-timing-summary.json instead.
+param(
+    [string]$Product,
+    [string]$Configuration,
+    [string]$SubCommand,
+    [switch]$Summarize
+)
+
+$logFile = Join-Path $PSScriptRoot 'qbs-build-timing.jsonl'
+$summaryFile = Join-Path $PSScriptRoot 'qbs-build-timing-summary.json'
+
+if ($Summarize) {
+    $records = @()
+    if (Test-Path $logFile) {
+        $records = @(Get-Content $logFile | Where-Object { $_ } | ForEach-Object { $_ | ConvertFrom-Json })
+    }
+    $products = @($records | Group-Object product, configuration, command | ForEach-Object {
+        $durations = @($_.Group | ForEach-Object { [double]$_.durationMs })
+        $last = $_.Group[-1]
+        [pscustomobject][ordered]@{
+            product = $last.product
+            configuration = $last.configuration
+            command = $last.command
+            runs = $_.Count
+            failures = @($_.Group | Where-Object { $_.exitCode -ne 0 }).Count
+            totalMs = ($durations | Measure-Object -Sum).Sum
+            maxMs = ($durations | Measure-Object -Maximum).Maximum
+            lastMs = [double]$last.durationMs
+            lastExitCode = $last.exitCode
+            lastEnd = $last.end
+        }
+    } | Sort-Object totalMs -Descending)
+    $summary = [ordered]@{
+        generated = (Get-Date).ToUniversalTime().ToString('o')
+        runs = $records.Count
+        totalMs = [double](@($records | ForEach-Object { [double]$_.durationMs }) | Measure-Object -Sum).Sum
+        products = $products
+    }
+    $summary | ConvertTo-Json -Depth 4 | Set-Content -Encoding UTF8 $summaryFile
+    $products | Format-Table product, configuration, command, runs, failures, totalMs, lastMs -AutoSize | Out-Host
+    exit 0
+}
+
+$phases = New-Object System.Collections.ArrayList
+$start = (Get-Date).ToUniversalTime()
+$stopwatch = [System.Diagnostics.Stopwatch]::StartNew()
+& cmd.exe /c $env:QBS_MSVS_TIMING_COMMAND 2>&1 | ForEach-Object {
+    $line = "$_"
+    # Printed by qbs --log-time.
+    if ($line -match "Activity '(.+)' took (.+)\.\s*$") {
+        [void]$phases.Add([ordered]@{ activity = $Matches[1]; duration = $Matches[2] })
+    }
+    [Console]::Out.WriteLine($line)
+}
+$exitCode = $LASTEXITCODE
+$stopwatch.Stop()
+
+$record = [ordered]@{
+    product = $Product
+    configuration = $Configuration
+    command = $SubCommand
+    start = $start.ToString('o')
+    end = $start.AddMilliseconds($stopwatch.ElapsedMilliseconds).ToString('o')
+    durationMs = $stopwatch.ElapsedMilliseconds
+    exitCode = $exitCode
+    phases = @($phases)
+}
+$entry = ($record | ConvertTo-Json -Compress -Depth 4) + [Environment]::NewLine
+
+# Products are built in parallel; serialize the appends.
+$mutex = New-Object System.Threading.Mutex($false, 'qbs-msvs-build-timing')
+[void]$mutex.WaitOne()
+try {
+    [System.IO.File]::AppendAllText($logFile, $entry)
+} finally {
+    $mutex.ReleaseMutex()
+}
+exit $exitCode
+)ps1";
+
+QString MsvsBuildTiming::scriptFilePath(const QString &buildDirectory)
+{
+    return QDir(buildDirectory).absoluteFilePath(QStringLiteral("qbs-msvs-timing.ps1"));
+}
+
+bool MsvsBuildTiming::writeScript(const QString &buildDirectory)
+{
+    return MsvsStagedOutput::instance().writeFile(scriptFilePath(buildDirectory),
+                                                  QByteArray(kTimingScript).replace("\n", "\r\n"));
+}
+
+// The command line is handed over in an environment variable, because PowerShell would
+// bind qbs options like "-f" to the script parameters.
+QString MsvsBuildTiming::wrapCommandLine(const QString &commandLine,
+                                         const QString &scriptPath,
+                                         const QString &productName,
+                                         const QString &configurationName,
+                                         const QString &subCommand)
+{
+    const QStringList args = QStringList()
+            << QStringLiteral("-NoProfile") << QStringLiteral("-NonInteractive")
+            << QStringLiteral("-ExecutionPolicy") << QStringLiteral("Bypass")
+            << QStringLiteral("-File") << QDir::toNativeSeparators(scriptPath)
+            << QStringLiteral("-Product") << productName
+            << QStringLiteral("-Configuration") << configurationName
+            << QStringLiteral("-SubCommand") << subCommand;
+    return QStringLiteral("set \"QBS_MSVS_TIMING_COMMAND=%1\"\n").arg(commandLine)
+            + Internal::shellQuote(QStringLiteral("powershell.exe"), args, Internal::HostOsInfo::HostOsWindows);
+}
+
+} // namespace qbs
@@ -0,0 +1,175 @@
+/****************************************************************************
+**
+** Copyright (C) 2015 The Qt Company Ltd.
+** Contact: http://www.qt.io/licensing
+**
+** This file is part of the Qt Build Suite.
+**
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms and
+** conditions see http://www.qt.io/terms-conditions. For further information
+** use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file.  Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, The Qt Company gives you certain additional
+** rights.  These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+****************************************************************************/
+
+
+#include "msvscompilationdatabasewriter.h"
+#include "msvsparallel.h"
+#include "msvspreparedproject.h"
+#include "msvsstagedoutput.h"
+#include "msvsstatistics.h"
+#include "msvstextencoder.h"
+
+#include <QDir>
+
+#include <vector>
+
+namespace qbs {
+
+static void appendJsonString(QByteArray &out, const QString &value)
+{
+    out += '"';
+    int begin = 0;
+    for (int i = 0; i < value.size(); ++i) {
+        const QChar c = value.at(i);
+        if (c != QLatin1Char('"') && c != QLatin1Char('\\') && c >= QLatin1Char(' '))
+            continue;
+        MsvsTextEncoder::appendUtf8(out, value.mid(begin, i - begin));
+        begin = i + 1;
+        if (c == QLatin1Char('"') || c == QLatin1Char('\\')) {
+            out += '\\';
+            out += char(c.unicode());
+        } else {
+            out += "\\u00";
+            out += QByteArray::number(c.unicode(), 16).rightJustified(2, '0');
+        }
+    }
+    MsvsTextEncoder::appendUtf8(out, value.mid(begin));
+    out += '"';
+}
+
+MsvsCompilationDatabaseWriter::MsvsCompilationDatabaseWriter(const VisualStudioGeneratorOptions &options)
+    : m_options(options)
+{
+}
+
+QString MsvsCompilationDatabaseWriter::filePath(const QString &buildDirectory)
+{
+    return QDir(buildDirectory).absoluteFilePath(QStringLiteral("compile_commands.json"));
+}
+
+bool MsvsCompilationDatabaseWriter::write(const MsvsPreparedProject &project,
+                                          const MsvsProjectConfiguration &buildTask,
+                                          const QString &buildDirectory) const
+{
+    QList<QSharedPointer<MsvsPreparedProduct> > products;
+    for (const QSharedPointer<MsvsPreparedProduct> &product : project.allProducts())
+        if (product->isSelected && product->configurations.contains(buildTask))
+            products << product;
+
+    // The entries of each product are written in order, without joining them first.
+    std::vector<QByteArray> parts(products.size() + 2);
+    parts.front() = "[";
+    MsvsParallel::forEach(products.size(), [&](int index) {
+        appendEntries(parts[index + 1], *products.at(index).data(), buildTask);
+    });
+    for (auto it = parts.rbegin(); it != parts.rend(); ++it) {
+        if (!it->isEmpty()) {
+            if (it->endsWith(','))
+                it->chop(1);
+            break;
+        }
+    }
+    parts.back() = "\n]\n";
+
+    qint64 size = 0;
+    for (const QByteArray &part : parts)
+        size += part.size();
+    MsvsStatistics::instance().recordRendered(size);
+    return MsvsStagedOutput::instance().writeFile(filePath(buildDirectory), parts);
+}
+
+void MsvsCompilationDatabaseWriter::appendEntries(QByteArray &out,
+                                                  const MsvsPreparedProduct &product,
+                                                  const MsvsProjectConfiguration &buildTask) const
+{
+    const ProductData &productData = product.configurations.value(buildTask);
+    const MsvsProductProperties &properties = product.propertiesFor(buildTask);
+
+    // The options shared by all files of the product, encoded once.
+    QByteArray commonArguments;
+    const auto appendArgument = [&commonArguments](const QString &argument) {
+        commonArguments += ',';
+        appendJsonString(commonArguments, argument);
+    };
+    appendArgument(QStringLiteral("/nologo"));
+    for (const QString &define : properties.defines)
+        appendArgument(QStringLiteral("/D") + define);
+    for (const QString &includePath : properties.allIncludePaths)
+        appendArgument(QStringLiteral("/I") + mapPath(includePath));
+    for (const QString &forcedInclude : properties.forcedIncludes)
+        appendArgument(QStringLiteral("/FI") + mapPath(forcedInclude));
+    for (const QString &option : properties.additionalCompilerOptions)
+        appendArgument(option);
+
+    QByteArray cxxArguments = ",\"/TP\"";
+    if (!properties.cxxStandard.isEmpty()) {
+        cxxArguments += ',';
+        appendJsonString(cxxArguments, QStringLiteral("/std:") + properties.cxxStandard);
+    }
+    QByteArray cArguments = ",\"/TC\"";
+    if (!properties.cStandard.isEmpty()) {
+        cArguments += ',';
+        appendJsonString(cArguments, QStringLiteral("/std:") + properties.cStandard);
+    }
+
+    QByteArray directory;
+    appendJsonString(directory, mapPath(buildTask.buildDirectory));
+
+    foreach (const GroupData &groupData, productData.groups()) {
+        if (!groupData.isEnabled())
+            continue;
+        foreach (const ArtifactData &artifact, groupData.allSourceArtifacts()) {
+            const QStringList fileTags = artifact.fileTags();
+            const bool isCxx = fileTags.contains(QStringLiteral("cpp"));
+            if (!isCxx && !fileTags.contains(QStringLiteral("c")))
+                continue;
+            QByteArray file;
+            appendJsonString(file, mapPath(artifact.filePath()));
+
+            out += "\n{\"directory\":";
+            out += directory;
+            out += ",\"file\":";
+            out += file;
+            out += ",\"arguments\":[\"cl.exe\"";
+            out += commonArguments;
+            out += isCxx ? cxxArguments : cArguments;
+            out += ",\"/c\",";
+            out += file;
+            out += "]},";
+        }
+    }
+}
+
+QString MsvsCompilationDatabaseWriter::mapPath(const QString &path) const
+{
+    return QDir::toNativeSeparators(m_options.mapPath(path));
+}
+
+} // namespace qbs
@@ -0,0 +1,73 @@
+/****************************************************************************
+**
+** Copyright (C) 2015 The Qt Company Ltd.
+** Contact: http://www.qt.io/licensing
+**
+** This file is part of the Qt Build Suite.
+**
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms and
+** conditions see http://www.qt.io/terms-conditions. For further information
+** use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file.  Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, The Qt Company gives you certain additional
+** rights.  These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+****************************************************************************/
+
+
+#ifndef QBS_MSVSCOMPILATIONDATABASEWRITER_H
+#define QBS_MSVSCOMPILATIONDATABASEWRITER_H
+
+#include "visualstudiogeneratoroptions.h"
+
+#include <QByteArray>
+
+namespace qbs {
+
+struct MsvsPreparedProduct;
+struct MsvsPreparedProject;
+struct MsvsProjectConfiguration;
+
+/*!
+ * \brief The MsvsCompilationDatabaseWriter class writes compile_commands.json for clangd
+ * and clang-tidy from the prepared project, so that no separate generator run has to
+ * resolve the project again. It contains one cl-style command per C and C++ source file of
+ * the selected products in one configuration. The entries of each product are rendered in
+ * parallel directly into UTF-8, without building a JSON document first.
+ */
+class MsvsCompilationDatabaseWriter
+{
+public:
+    MsvsCompilationDatabaseWriter(const VisualStudioGeneratorOptions &options);
+
+    static QString filePath(const QString &buildDirectory);
+    bool write(const MsvsPreparedProject &project,
+               const MsvsProjectConfiguration &buildTask,
+               const QString &buildDirectory) const;
+
+private:
+    // Appends the entries of one product, each followed by a comma.
+    void appendEntries(QByteArray &out, const MsvsPreparedProduct &product,
+                       const MsvsProjectConfiguration &buildTask) const;
+    QString mapPath(const QString &path) const;
+
+    const VisualStudioGeneratorOptions m_options;
+};
+
+} // namespace qbs
+
+#endif // QBS_MSVSCOMPILATIONDATABASEWRITER_H
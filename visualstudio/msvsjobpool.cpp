@@ -0,0 +1,98 @@
+/****************************************************************************
+**
+** Copyright (C) 2015 The Qt Company Ltd.
+** Contact: http://www.qt.io/licensing
+**
+** This file is part of the Qt Build Suite.
+**
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms and
+** conditions see http://www.qt.io/terms-conditions. For further information
+** use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file.  Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, The Qt Company gives you certain additional
+** rights.  These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+****************************************************************************/
+
+
+#include "msvsjobpool.h"
+#include "msvsstagedoutput.h"
+
+#include <tools/hostosinfo.h>
+#include <tools/shellutils.h>
+
+#include <QCryptographicHash>
+#include <QDir>
+
+namespace qbs {
+
+static const char kJobPoolScript[] = R"ps1(# Generated by qbs. Changes are overwritten by "qbs generate".
+# Runs the command line in QBS_MSVS_JOBPOOL_COMMAND once one of the -Size slots of the pool is free.
+param(
+    [string]$Name,
+    [int]$Size
+)
+
+# The semaphore lives as long as one of the builds using it, so slots of killed builds
+# are not lost beyond the end of the build.
+$pool = New-Object System.Threading.Semaphore($Size, $Size, $Name)
+[void]$pool.WaitOne()
+try {
+    & cmd.exe /c $env:QBS_MSVS_JOBPOOL_COMMAND
+    $exitCode = $LASTEXITCODE
+} finally {
+    [void]$pool.Release()
+}
+exit $exitCode
+)ps1";
+
+QString MsvsJobPool::scriptFilePath(const QString &buildDirectory)
+{
+    return QDir(buildDirectory).absoluteFilePath(QStringLiteral("qbs-msvs-jobpool.ps1"));
+}
+
+bool MsvsJobPool::writeScript(const QString &buildDirectory)
+{
+    return MsvsStagedOutput::instance().writeFile(scriptFilePath(buildDirectory),
+                                                  QByteArray(kJobPoolScript).replace("\n", "\r\n"));
+}
+
+// Like the timing wrapper, the command line is handed over in an environment variable.
+// Builds of different build directories use different pools.
+QString MsvsJobPool::wrapCommandLine(const QString &commandLine,
+                                     const QString &scriptPath,
+                                     const QString &buildDirectory,
+                                     int size)
+{
+    const QByteArray buildDirectoryHash = QCryptographicHash::hash(
+                QDir::cleanPath(buildDirectory).toLower().toUtf8(), QCryptographicHash::Sha1).toHex();
+    const QStringList args = QStringList()
+            << QStringLiteral("-NoProfile") << QStringLiteral("-NonInteractive")
+            << QStringLiteral("-ExecutionPolicy") << QStringLiteral("Bypass")
+            << QStringLiteral("-File") << QDir::toNativeSeparators(scriptPath)
+            << QStringLiteral("-Name")
+            << QStringLiteral("Local\\qbs-msvs-jobpool-") + QString::fromLatin1(buildDirectoryHash.left(16))
+            << QStringLiteral("-Size") << QString::number(size);
+    // The pool script runs a single command, so the leading lines of a command script,
+    // which only set variables for its last line, stay in front of the wrapper.
+    const int lastLine = commandLine.lastIndexOf(QLatin1Char('\n')) + 1;
+    return commandLine.left(lastLine)
+            + QStringLiteral("set \"QBS_MSVS_JOBPOOL_COMMAND=%1\"\n").arg(commandLine.mid(lastLine))
+            + Internal::shellQuote(QStringLiteral("powershell.exe"), args, Internal::HostOsInfo::HostOsWindows);
+}
+
+} // namespace qbs
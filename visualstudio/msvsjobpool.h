@@ -0,0 +1,64 @@
+/****************************************************************************
+**
+** Copyright (C) 2015 The Qt Company Ltd.
+** Contact: http://www.qt.io/licensing
+**
+** This file is part of the Qt Build Suite.
+**
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms and
+** conditions see http://www.qt.io/terms-conditions. For further information
+** use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file.  Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, The Qt Company gives you certain additional
+** rights.  These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+****************************************************************************/
+
+
+#ifndef QBS_MSVSJOBPOOL_H
+#define QBS_MSVSJOBPOOL_H
+
+#include <QString>
+
+namespace qbs {
+
+/*!
+ * \brief The MsvsJobPool class provides the token pool shared by the qbs processes Visual
+ * Studio starts for parallel project builds. The pool is a PowerShell script in the qbs build
+ * directory, which takes one of a fixed number of slots of a named semaphore before it runs
+ * the qbs command line, and gives it back afterwards. Together with a matching job count per
+ * qbs process, the machine runs at full load without oversubscribing it.
+ */
+class MsvsJobPool
+{
+public:
+    static QString scriptFilePath(const QString &buildDirectory);
+
+    static bool writeScript(const QString &buildDirectory);
+
+    // Returns a command script running commandLine with one slot of the pool of the given size.
+    // commandLine may itself be a command script whose leading lines set variables only,
+    // such as the one of MsvsBuildTiming::wrapCommandLine().
+    static QString wrapCommandLine(const QString &commandLine,
+                                   const QString &scriptPath,
+                                   const QString &buildDirectory,
+                                   int size);
+};
+
+} // namespace qbs
+
+#endif // QBS_MSVSJOBPOOL_H
@@ -0,0 +1,305 @@
+/****************************************************************************
+**
+** Copyright (C) 2015 The Qt Company Ltd.
+** Contact: http://www.qt.io/licensing
+**
+** This file is part of the Qt Build Suite.
+**
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms and
+** conditions see http://www.qt.io/terms-conditions. For further information
+** use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file.  Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, The Qt Company gives you certain additional
+** rights.  These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+****************************************************************************/
+
+
+#include "msvsmemoryaccounting.h"
+
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutexLocker>
+#include <QTextStream>
+
+#if defined(Q_OS_WIN)
+#include <windows.h>
+#include <psapi.h>
+#elif defined(Q_OS_UNIX)
+#include <sys/resource.h>
+#endif
+
+namespace qbs {
+
+// Rough per-node overhead of the Qt containers on top of key and value.
+static const qint64 kHashNodeOverhead = 2 * sizeof(void *);
+static const qint64 kMapNodeOverhead = 3 * sizeof(void *);
+static const qint64 kArrayDataOverhead = 3 * sizeof(int) + sizeof(qptrdiff);
+
+MsvsMemoryAccounting &MsvsMemoryAccounting::instance()
+{
+    static MsvsMemoryAccounting accounting;
+    return accounting;
+}
+
+void MsvsMemoryAccounting::setEnabled(bool enabled)
+{
+    QMutexLocker locker(&m_mutex);
+    m_enabled = enabled;
+    m_structureOrder.clear();
+    m_structures.clear();
+    m_phases.clear();
+    m_currentPhase = Phase();
+}
+
+void MsvsMemoryAccounting::beginPhase(const QString &name)
+{
+    if (!m_enabled)
+        return;
+    QMutexLocker locker(&m_mutex);
+    m_currentPhase = Phase();
+    m_currentPhase.name = name;
+    m_currentPhase.peakIsPhaseLocal = resetPeakResidentSetSize();
+}
+
+void MsvsMemoryAccounting::endPhase()
+{
+    if (!m_enabled)
+        return;
+    QMutexLocker locker(&m_mutex);
+    m_currentPhase.residentSetSize = currentResidentSetSize();
+    m_currentPhase.peakResidentSetSize = peakResidentSetSize();
+    m_phases << m_currentPhase;
+    m_currentPhase = Phase();
+}
+
+void MsvsMemoryAccounting::record(const QString &structure, qint64 bytes, qint64 elements)
+{
+    if (!m_enabled)
+        return;
+    QMutexLocker locker(&m_mutex);
+    if (!m_structures.contains(structure))
+        m_structureOrder << structure;
+    Structure &entry = m_structures[structure];
+    ++entry.samples;
+    entry.totalBytes += bytes;
+    entry.peakBytes = qMax(entry.peakBytes, bytes);
+    entry.totalElements += elements;
+    entry.peakElements = qMax(entry.peakElements, elements);
+}
+
+void MsvsMemoryAccounting::recordPreparedProject(const MsvsPreparedProject &project)
+{
+    if (!m_enabled)
+        return;
+
+    qint64 productBytes = 0;
+    qint64 configurationBytes = 0;
+    qint64 configurationCount = 0;
+    qint64 filePathBytes = 0;
+    qint64 filePathCount = 0;
+    const QList<QSharedPointer<MsvsPreparedProduct> > products = project.allProducts();
+    for (const QSharedPointer<MsvsPreparedProduct> &product : products) {
+        productBytes += sizeof(MsvsPreparedProduct) + kMapNodeOverhead
+                + sizeOf(product->name) + sizeOf(product->guid)
+                + sizeOf(product->outputSubdirectory);
+        for (auto it = product->configurations.cbegin(); it != product->configurations.cend(); ++it) {
+            configurationBytes += kMapNodeOverhead + sizeof(MsvsProjectConfiguration) + sizeof(ProductData)
+                    + sizeOf(it.key().profile) + sizeOf(it.key().variant) + sizeOf(it.key().platform)
+                    + sizeOf(it.key().commandLineParameters);
+            ++configurationCount;
+            for (const GroupData &groupData : it.value().groups()) {
+                const QStringList filePaths = groupData.allFilePaths();
+                filePathBytes += sizeOf(filePaths);
+                filePathCount += filePaths.size();
+            }
+        }
+    }
+
+    record(QStringLiteral("prepared products"), productBytes, products.size());
+    record(QStringLiteral("prepared configurations"), configurationBytes, configurationCount);
+    record(QStringLiteral("prepared configuration file paths"), filePathBytes, filePathCount);
+}
+
+static QString formatBytes(qint64 bytes)
+{
+    if (bytes >= 1024 * 1024)
+        return QStringLiteral("%1 MiB").arg(bytes / (1024.0 * 1024.0), 0, 'f', 1);
+    if (bytes >= 1024)
+        return QStringLiteral("%1 KiB").arg(bytes / 1024.0, 0, 'f', 1);
+    return QStringLiteral("%1 B").arg(bytes);
+}
+
+QString MsvsMemoryAccounting::report() const
+{
+    QMutexLocker locker(&m_mutex);
+    QString result;
+    QTextStream stream(&result);
+    stream << "Memory accounting (estimated heap payload):\n";
+    for (const QString &name : m_structureOrder) {
+        const Structure &entry = m_structures[name];
+        stream << "  " << name << ": " << entry.samples << " samples, total "
+               << formatBytes(entry.totalBytes) << " / " << entry.totalElements << " elements, peak "
+               << formatBytes(entry.peakBytes) << " / " << entry.peakElements << " elements\n";
+    }
+    stream << "Resident set size per phase:\n";
+    for (const Phase &phase : m_phases) {
+        stream << "  " << phase.name << ": current " << formatBytes(phase.residentSetSize)
+               << ", high-water " << formatBytes(phase.peakResidentSetSize)
+               << (phase.peakIsPhaseLocal ? "" : " (process-wide)") << '\n';
+    }
+    return result;
+}
+
+QJsonObject MsvsMemoryAccounting::toJson() const
+{
+    QMutexLocker locker(&m_mutex);
+    QJsonArray structures;
+    for (const QString &name : m_structureOrder) {
+        const Structure &entry = m_structures[name];
+        QJsonObject object;
+        object.insert(QStringLiteral("name"), name);
+        object.insert(QStringLiteral("samples"), entry.samples);
+        object.insert(QStringLiteral("totalBytes"), entry.totalBytes);
+        object.insert(QStringLiteral("peakBytes"), entry.peakBytes);
+        object.insert(QStringLiteral("totalElements"), entry.totalElements);
+        object.insert(QStringLiteral("peakElements"), entry.peakElements);
+        structures.append(object);
+    }
+
+    QJsonArray phases;
+    for (const Phase &phase : m_phases) {
+        QJsonObject object;
+        object.insert(QStringLiteral("name"), phase.name);
+        object.insert(QStringLiteral("residentSetSize"), phase.residentSetSize);
+        object.insert(QStringLiteral("peakResidentSetSize"), phase.peakResidentSetSize);
+        object.insert(QStringLiteral("peakIsPhaseLocal"), phase.peakIsPhaseLocal);
+        phases.append(object);
+    }
+
+    QJsonObject result;
+    result.insert(QStringLiteral("structures"), structures);
+    result.insert(QStringLiteral("phases"), phases);
+    return result;
+}
+
+bool MsvsMemoryAccounting::writeJson(const QString &filePath) const
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly))
+        return false;
+    file.write(QJsonDocument(toJson()).toJson());
+    return file.flush();
+}
+
+qint64 MsvsMemoryAccounting::sizeOf(const QString &string)
+{
+    return sizeof(QString) + (string.isNull() ? 0 : kArrayDataOverhead + (string.capacity() + 1) * sizeof(QChar));
+}
+
+qint64 MsvsMemoryAccounting::sizeOf(const QStringList &list)
+{
+    qint64 result = sizeof(QStringList) + kArrayDataOverhead + list.size() * sizeof(void *);
+    for (const QString &string : list)
+        result += sizeOf(string);
+    return result;
+}
+
+qint64 MsvsMemoryAccounting::sizeOf(const QSet<QString> &set)
+{
+    qint64 result = sizeof(QSet<QString>) + set.capacity() * sizeof(void *);
+    for (const QString &string : set)
+        result += kHashNodeOverhead + sizeOf(string);
+    return result;
+}
+
+qint64 MsvsMemoryAccounting::sizeOf(const QHash<QString, QSet<MsvsProjectConfiguration> > &hash)
+{
+    qint64 result = sizeof(hash) + hash.capacity() * sizeof(void *);
+    for (auto it = hash.cbegin(); it != hash.cend(); ++it) {
+        result += kHashNodeOverhead + sizeOf(it.key()) + sizeof(QSet<MsvsProjectConfiguration>)
+                + it.value().capacity() * sizeof(void *)
+                + it.value().size() * (kHashNodeOverhead + sizeof(MsvsProjectConfiguration));
+    }
+    return result;
+}
+
+#if defined(Q_OS_LINUX)
+static qint64 procStatusValue(const QByteArray &key)
+{
+    QFile file(QStringLiteral("/proc/self/status"));
+    if (!file.open(QIODevice::ReadOnly))
+        return 0;
+    for (const QByteArray &line : file.readAll().split('\n')) {
+        if (line.startsWith(key))
+            return line.mid(key.size()).simplified().split(' ').first().toLongLong() * 1024;
+    }
+    return 0;
+}
+#endif
+
+qint64 MsvsMemoryAccounting::currentResidentSetSize()
+{
+#if defined(Q_OS_LINUX)
+    return procStatusValue("VmRSS:");
+#elif defined(Q_OS_WIN)
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return counters.WorkingSetSize;
+    return 0;
+#else
+    return 0;
+#endif
+}
+
+qint64 MsvsMemoryAccounting::peakResidentSetSize()
+{
+#if defined(Q_OS_LINUX)
+    return procStatusValue("VmHWM:");
+#elif defined(Q_OS_WIN)
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return counters.PeakWorkingSetSize;
+    return 0;
+#elif defined(Q_OS_UNIX)
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0;
+#if defined(Q_OS_MAC)
+    return usage.ru_maxrss;
+#else
+    return qint64(usage.ru_maxrss) * 1024;
+#endif
+#else
+    return 0;
+#endif
+}
+
+// Only Linux allows to reset the high-water mark, elsewhere it covers the whole process lifetime.
+bool MsvsMemoryAccounting::resetPeakResidentSetSize()
+{
+#if defined(Q_OS_LINUX)
+    QFile file(QStringLiteral("/proc/self/clear_refs"));
+    return file.open(QIODevice::WriteOnly) && file.write("5") == 1;
+#else
+    return false;
+#endif
+}
+
+} // namespace qbs
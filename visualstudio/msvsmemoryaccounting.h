@@ -0,0 +1,107 @@
+/****************************************************************************
+**
+** Copyright (C) 2015 The Qt Company Ltd.
+** Contact: http://www.qt.io/licensing
+**
+** This file is part of the Qt Build Suite.
+**
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms and
+** conditions see http://www.qt.io/terms-conditions. For further information
+** use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file.  Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, The Qt Company gives you certain additional
+** rights.  These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+****************************************************************************/
+
+
+#ifndef QBS_MSVSMEMORYACCOUNTING_H
+#define QBS_MSVSMEMORYACCOUNTING_H
+
+#include "msvspreparedproject.h"
+
+#include <QMutex>
+
+QT_BEGIN_NAMESPACE
+class QJsonObject;
+QT_END_NAMESPACE
+
+namespace qbs {
+
+/*!
+ * \brief The MsvsMemoryAccounting class collects opt-in memory statistics of the generator.
+ * Byte counts are estimates of the heap payload of the Qt containers, implicitly shared
+ * data is counted once per reference.
+ */
+class MsvsMemoryAccounting
+{
+public:
+    static MsvsMemoryAccounting &instance();
+
+    bool isEnabled() const { return m_enabled; }
+    void setEnabled(bool enabled);
+
+    void beginPhase(const QString &name);
+    void endPhase();
+
+    void record(const QString &structure, qint64 bytes, qint64 elements);
+    void recordPreparedProject(const MsvsPreparedProject &project);
+
+    QString report() const;
+    QJsonObject toJson() const;
+    bool writeJson(const QString &filePath) const;
+
+    static qint64 sizeOf(const QString &string);
+    static qint64 sizeOf(const QStringList &list);
+    static qint64 sizeOf(const QSet<QString> &set);
+    static qint64 sizeOf(const QHash<QString, QSet<MsvsProjectConfiguration> > &hash);
+
+    static qint64 currentResidentSetSize();
+    static qint64 peakResidentSetSize();
+
+private:
+    MsvsMemoryAccounting() = default;
+    static bool resetPeakResidentSetSize();
+
+    struct Structure
+    {
+        qint64 samples = 0;
+        qint64 totalBytes = 0;
+        qint64 peakBytes = 0;
+        qint64 totalElements = 0;
+        qint64 peakElements = 0;
+    };
+
+    struct Phase
+    {
+        QString name;
+        qint64 residentSetSize = 0;
+        qint64 peakResidentSetSize = 0;
+        bool peakIsPhaseLocal = false;
+    };
+
+    bool m_enabled = false;
+    mutable QMutex m_mutex;
+    QStringList m_structureOrder;
+    QHash<QString, Structure> m_structures;
+    QList<Phase> m_phases;
+    Phase m_currentPhase;
+};
+
+} // namespace qbs
+
+#endif // QBS_MSVSMEMORYACCOUNTING_H
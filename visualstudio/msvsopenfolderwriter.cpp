@@ -0,0 +1,204 @@
+/****************************************************************************
+**
+** Copyright (C) 2015 The Qt Company Ltd.
+** Contact: http://www.qt.io/licensing
+**
+** This file is part of the Qt Build Suite.
+**
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms and
+** conditions see http://www.qt.io/terms-conditions. For further information
+** use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file.  Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, The Qt Company gives you certain additional
+** rights.  These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+****************************************************************************/
+
+
+#include "msvsopenfolderwriter.h"
+#include "msvspreparedproject.h"
+#include "msvsstagedoutput.h"
+
+#include <QDir>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+namespace qbs {
+
+static const QString kSchemaVersion = QStringLiteral("0.2.1");
+
+// The toolset environment and IntelliSense mode of each platform.
+static QString platformSuffix(const QString &platform)
+{
+    if (platform == QStringLiteral("Win32"))
+        return QStringLiteral("x86");
+    return platform.toLower();
+}
+
+static void appendUnique(QStringList &list, const QStringList &values)
+{
+    for (const QString &value : values)
+        if (!list.contains(value))
+            list << value;
+}
+
+static QByteArray toJson(const QJsonObject &object)
+{
+    return QJsonDocument(object).toJson(QJsonDocument::Indented);
+}
+
+MsvsOpenFolderWriter::MsvsOpenFolderWriter(const VisualStudioGeneratorOptions &options)
+    : m_options(options)
+{
+}
+
+QStringList MsvsOpenFolderWriter::outputFilePaths(const QString &folderPath) const
+{
+    const QDir folder(folderPath);
+    return QStringList()
+            << folder.absoluteFilePath(QStringLiteral("CppProperties.json"))
+            << folder.absoluteFilePath(QStringLiteral(".vs/launch.vs.json"))
+            << folder.absoluteFilePath(QStringLiteral(".vs/tasks.vs.json"));
+}
+
+bool MsvsOpenFolderWriter::write(const MsvsPreparedProject &project, const QString &folderPath) const
+{
+    MsvsStagedOutput &output = MsvsStagedOutput::instance();
+    if (!output.isArchive() && !QDir(folderPath).mkpath(QStringLiteral(".vs")))
+        return false;
+
+    const QStringList filePaths = outputFilePaths(folderPath);
+
+    QJsonObject cppProperties;
+    cppProperties.insert(QStringLiteral("configurations"), cppPropertiesConfigurations(project));
+
+    QJsonObject launch;
+    launch.insert(QStringLiteral("version"), kSchemaVersion);
+    launch.insert(QStringLiteral("defaults"), QJsonObject());
+    launch.insert(QStringLiteral("configurations"), launchConfigurations(project));
+
+    QJsonObject tasksFile;
+    tasksFile.insert(QStringLiteral("version"), kSchemaVersion);
+    tasksFile.insert(QStringLiteral("tasks"), tasks(project));
+
+    return output.writeFile(filePaths.at(0), toJson(cppProperties))
+            && output.writeFile(filePaths.at(1), toJson(launch))
+            && output.writeFile(filePaths.at(2), toJson(tasksFile));
+}
+
+// A folder has no products, so each configuration gets the union of the include paths
+// and defines of all products.
+QJsonArray MsvsOpenFolderWriter::cppPropertiesConfigurations(const MsvsPreparedProject &project) const
+{
+    const QList<QSharedPointer<MsvsPreparedProduct> > products = project.allProducts();
+
+    QJsonArray result;
+    for (const MsvsProjectConfiguration &buildTask : project.enabledConfigurations) {
+        QStringList includePaths;
+        QStringList defines;
+        QString cxxStandard;
+        for (const QSharedPointer<MsvsPreparedProduct> &product : products) {
+            if (!product->isSelected || !product->properties.contains(buildTask))
+                continue;
+            const MsvsProductProperties &properties = product->propertiesFor(buildTask);
+            for (const QString &includePath : properties.allIncludePaths)
+                appendUnique(includePaths, QStringList(mapPath(includePath)));
+            appendUnique(defines, properties.defines);
+            if (cxxStandard.isEmpty())
+                cxxStandard = properties.cxxStandard;
+        }
+
+        const QString platform = platformSuffix(buildTask.platform);
+        QJsonObject configuration;
+        configuration.insert(QStringLiteral("name"), buildTask.fullName());
+        configuration.insert(QStringLiteral("inheritEnvironments"),
+                             QJsonArray::fromStringList(QStringList(QStringLiteral("msvc_") + platform)));
+        configuration.insert(QStringLiteral("intelliSenseMode"), QStringLiteral("windows-msvc-") + platform);
+        configuration.insert(QStringLiteral("includePath"), QJsonArray::fromStringList(includePaths));
+        configuration.insert(QStringLiteral("defines"), QJsonArray::fromStringList(defines));
+        if (!cxxStandard.isEmpty())
+            configuration.insert(QStringLiteral("compilerSwitches"), QStringLiteral("/std:") + cxxStandard);
+        result << configuration;
+    }
+    return result;
+}
+
+QJsonArray MsvsOpenFolderWriter::launchConfigurations(const MsvsPreparedProject &project) const
+{
+    QJsonArray result;
+    for (const QSharedPointer<MsvsPreparedProduct> &product : project.allProducts()) {
+        if (!product->isSelected || !product->isApplication)
+            continue;
+        for (const MsvsProjectConfiguration &buildTask : product->configurations.keys()) {
+            const MsvsProductProperties &properties = product->propertiesFor(buildTask);
+            const QString targetFilePath = properties.targetPath + properties.targetName;
+            QJsonObject configuration;
+            configuration.insert(QStringLiteral("type"), QStringLiteral("default"));
+            configuration.insert(QStringLiteral("name"), QStringLiteral("%1 (%2)")
+                                 .arg(product->name, buildTask.fullName()));
+            configuration.insert(QStringLiteral("project"), mapPath(targetFilePath));
+            configuration.insert(QStringLiteral("projectTarget"), QString());
+            configuration.insert(QStringLiteral("currentDir"), mapPath(properties.targetPath));
+            result << configuration;
+        }
+    }
+    return result;
+}
+
+QJsonArray MsvsOpenFolderWriter::tasks(const MsvsPreparedProject &project) const
+{
+    QJsonArray result;
+    for (const MsvsProjectConfiguration &buildTask : project.enabledConfigurations) {
+        result << task(buildTask, buildTask.buildSubCommand());
+        result << task(buildTask, QStringLiteral("clean"));
+    }
+    return result;
+}
+
+// Like the commands of the projects, for the whole qbs project instead of one product.
+QJsonObject MsvsOpenFolderWriter::task(const MsvsProjectConfiguration &buildTask,
+                                       const QString &subCommand) const
+{
+    QStringList args = QStringList()
+            << subCommand
+            << QStringLiteral("-f") << mapPath(buildTask.qbsProjectFile)
+            << QStringLiteral("-d") << mapPath(buildTask.buildDirectory);
+    if (subCommand == QStringLiteral("build") && !buildTask.installsOnBuild())
+        args << QStringLiteral("--no-install");
+    if (subCommand != QStringLiteral("clean") && buildTask.installsOnBuild() && !buildTask.installRoot.isEmpty())
+        args << QStringLiteral("--install-root") << mapPath(buildTask.installRoot);
+    args << buildTask.variant << QStringLiteral("profile:") + buildTask.profile
+         << buildTask.commandLineParameters;
+
+    QJsonObject result;
+    result.insert(QStringLiteral("taskLabel"), QStringLiteral("qbs %1 (%2)")
+                  .arg(subCommand, buildTask.fullName()));
+    result.insert(QStringLiteral("appliesTo"), QStringLiteral("/"));
+    result.insert(QStringLiteral("type"), QStringLiteral("launch"));
+    result.insert(QStringLiteral("contextType"), subCommand == QStringLiteral("clean")
+                  ? QStringLiteral("clean") : QStringLiteral("build"));
+    result.insert(QStringLiteral("command"), mapPath(buildTask.qbsExecutablePath));
+    result.insert(QStringLiteral("args"), QJsonArray::fromStringList(args));
+    return result;
+}
+
+QString MsvsOpenFolderWriter::mapPath(const QString &path) const
+{
+    return QDir::toNativeSeparators(m_options.mapPath(path));
+}
+
+} // namespace qbs
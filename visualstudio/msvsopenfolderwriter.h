@@ -0,0 +1,73 @@
+/****************************************************************************
+**
+** Copyright (C) 2015 The Qt Company Ltd.
+** Contact: http://www.qt.io/licensing
+**
+** This file is part of the Qt Build Suite.
+**
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms and
+** conditions see http://www.qt.io/terms-conditions. For further information
+** use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file.  Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, The Qt Company gives you certain additional
+** rights.  These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+****************************************************************************/
+
+
+#ifndef QBS_MSVSOPENFOLDERWRITER_H
+#define QBS_MSVSOPENFOLDERWRITER_H
+
+#include "visualstudiogeneratoroptions.h"
+
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QStringList>
+
+namespace qbs {
+
+struct MsvsPreparedProject;
+struct MsvsProjectConfiguration;
+
+/*!
+ * \brief The MsvsOpenFolderWriter class writes the metadata Visual Studio reads when it opens
+ * a folder instead of a solution: CppProperties.json with the include paths and defines of
+ * every configuration, .vs/launch.vs.json with the applications to debug, and
+ * .vs/tasks.vs.json with the qbs build and clean commands. Visual Studio then indexes the
+ * sources without evaluating a single project file.
+ */
+class MsvsOpenFolderWriter
+{
+public:
+    MsvsOpenFolderWriter(const VisualStudioGeneratorOptions &options);
+
+    QStringList outputFilePaths(const QString &folderPath) const;
+    bool write(const MsvsPreparedProject &project, const QString &folderPath) const;
+
+private:
+    QJsonArray cppPropertiesConfigurations(const MsvsPreparedProject &project) const;
+    QJsonArray launchConfigurations(const MsvsPreparedProject &project) const;
+    QJsonArray tasks(const MsvsPreparedProject &project) const;
+    QJsonObject task(const MsvsProjectConfiguration &buildTask, const QString &subCommand) const;
+    QString mapPath(const QString &path) const;
+
+    const VisualStudioGeneratorOptions m_options;
+};
+
+} // namespace qbs
+
+#endif // QBS_MSVSOPENFOLDERWRITER_H
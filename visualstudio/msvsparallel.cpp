@@ -0,0 +1,194 @@
+/****************************************************************************
+**
+** Copyright (C) 2015 The Qt Company Ltd.
+** Contact: http://www.qt.io/licensing
+**
+** This file is part of the Qt Build Suite.
+**
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms and
+** conditions see http://www.qt.io/terms-conditions. For further information
+** use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file.  Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, The Qt Company gives you certain additional
+** rights.  These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+****************************************************************************/
+#include "msvsparallel.h"
+
+#include <QList>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QRunnable>
+#include <QThreadPool>
+#include <QWaitCondition>
+
+#include <exception>
+
+namespace qbs {
+
+namespace {
+
+// One forEach() call. All fields are guarded by the scheduler mutex.
+struct ParallelLoop
+{
+    ParallelLoop(int count, const std::function<void(int)> &job) : count(count), job(job) { }
+
+    bool hasItems() const { return !error && next < count; }
+    bool isComplete() const { return !hasItems() && finished == next; }
+
+    const int count;
+    const std::function<void(int)> &job;
+    int next = 0;
+    int finished = 0;
+    std::exception_ptr error;
+};
+
+// The loops of all running forEach() calls form one shared queue. Every thread without
+// work of its own takes items from it, innermost loops first, so the chunks of a large
+// product are picked up by whichever thread becomes idle, not only by the threads idle
+// when the chunks were queued.
+class ParallelScheduler
+{
+public:
+    static ParallelScheduler &instance()
+    {
+        static ParallelScheduler scheduler;
+        return scheduler;
+    }
+
+    void run(ParallelLoop &loop);
+    void help();
+
+private:
+    ParallelScheduler() = default;
+
+    // Takes an item of loop, or else of a loop queued after it. Without a loop,
+    // any item is taken. Expects the mutex to be locked.
+    bool takeItem(ParallelLoop *loop, ParallelLoop **itemLoop, int *index);
+    // Runs an item with the mutex unlocked.
+    void runItem(ParallelLoop &loop, int index);
+
+    QMutex m_mutex;
+    QWaitCondition m_changed;
+    QList<ParallelLoop *> m_loops;
+};
+
+class ParallelHelper : public QRunnable
+{
+public:
+    void run() override { ParallelScheduler::instance().help(); }
+};
+
+bool ParallelScheduler::takeItem(ParallelLoop *loop, ParallelLoop **itemLoop, int *index)
+{
+    if (loop && loop->hasItems()) {
+        *itemLoop = loop;
+    } else {
+        *itemLoop = nullptr;
+        const int first = loop ? m_loops.indexOf(loop) + 1 : 0;
+        for (int i = m_loops.size() - 1; i >= first && !*itemLoop; --i)
+            if (m_loops.at(i)->hasItems())
+                *itemLoop = m_loops.at(i);
+        if (!*itemLoop)
+            return false;
+    }
+    *index = (*itemLoop)->next++;
+    return true;
+}
+
+void ParallelScheduler::runItem(ParallelLoop &loop, int index)
+{
+    std::exception_ptr error;
+    m_mutex.unlock();
+    try {
+        loop.job(index);
+    } catch (...) {
+        error = std::current_exception();
+    }
+    m_mutex.lock();
+    if (error && !loop.error)
+        loop.error = error;
+    ++loop.finished;
+    m_changed.wakeAll();
+}
+
+// The calling thread works on its own loop, and on the nested loops of other threads
+// while it waits for the items taken by others.
+void ParallelScheduler::run(ParallelLoop &loop)
+{
+    QMutexLocker locker(&m_mutex);
+    m_loops << &loop;
+    m_changed.wakeAll();
+
+    QThreadPool *pool = QThreadPool::globalInstance();
+    for (int i = 1; i < qMin(loop.count, pool->maxThreadCount()); ++i) {
+        ParallelHelper *helper = new ParallelHelper;
+        if (!pool->tryStart(helper)) { // no idle thread, busy ones come back to the queue
+            delete helper;
+            break;
+        }
+    }
+
+    while (!loop.isComplete()) {
+        ParallelLoop *itemLoop;
+        int index;
+        if (takeItem(&loop, &itemLoop, &index))
+            runItem(*itemLoop, index);
+        else
+            m_changed.wait(&m_mutex);
+    }
+    m_loops.removeOne(&loop);
+    if (loop.error)
+        std::rethrow_exception(loop.error);
+}
+
+// Pool threads take items until the queue runs dry.
+void ParallelScheduler::help()
+{
+    QMutexLocker locker(&m_mutex);
+    ParallelLoop *itemLoop;
+    int index;
+    while (takeItem(nullptr, &itemLoop, &index))
+        runItem(*itemLoop, index);
+}
+
+} // namespace
+
+void MsvsParallel::forEach(int count, const std::function<void(int)> &job)
+{
+    if (count <= 0)
+        return;
+    ParallelLoop loop(count, job);
+    ParallelScheduler::instance().run(loop);
+}
+
+void MsvsParallel::forEachChunk(int count, int chunkSize,
+                                const std::function<void(int begin, int end)> &job)
+{
+    if (count <= chunkSize) {
+        if (count > 0)
+            job(0, count);
+        return;
+    }
+
+    const int chunkCount = (count + chunkSize - 1) / chunkSize;
+    forEach(chunkCount, [&](int chunk) {
+        job(chunk * chunkSize, qMin(count, (chunk + 1) * chunkSize));
+    });
+}
+
+} // namespace qbs
@@ -0,0 +1,62 @@
+/****************************************************************************
+**
+** Copyright (C) 2015 The Qt Company Ltd.
+** Contact: http://www.qt.io/licensing
+**
+** This file is part of the Qt Build Suite.
+**
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms and
+** conditions see http://www.qt.io/terms-conditions. For further information
+** use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file.  Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, The Qt Company gives you certain additional
+** rights.  These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+****************************************************************************/
+
+
+#ifndef QBS_MSVSPARALLEL_H
+#define QBS_MSVSPARALLEL_H
+
+#include <functional>
+
+namespace qbs {
+
+/*!
+ * \brief The MsvsParallel class runs generator work items on the global thread pool.
+ * The items of all running calls form one shared queue. The calling thread takes part in
+ * the work, helpers are started on idle pool threads, and every thread out of work takes the
+ * next item of the innermost call that has any. The chunks of a large product, queued from
+ * a product task while the pool is busy, are thus drained by whichever threads finish their
+ * products first, and no thread waits for work queued behind a blocked one. The first
+ * exception thrown by a work item stops the remaining items of its call and is rethrown in
+ * the calling thread.
+ */
+class MsvsParallel
+{
+public:
+    // Products with fewer files are rendered by one thread.
+    static const int fileChunkSize = 1024;
+
+    static void forEach(int count, const std::function<void(int index)> &job);
+    static void forEachChunk(int count, int chunkSize,
+                             const std::function<void(int begin, int end)> &job);
+};
+
+} // namespace qbs
+
+#endif // QBS_MSVSPARALLEL_H
@@ -29,6 +29,9 @@
 ****************************************************************************/
 
 #include "msvspreparedproject.h"
+#include "msvsshards.h"
+
+#include <tools/qbsassert.h>
 
 #include <QDebug>
 #include <QFileInfo>
@@ -49,6 +52,31 @@ static const QString visualStudioArchitectureName(const QString &qbsArch)
     return map[qbsArch];
 }
 
+// Namespace of the name-based GUIDs of the generated projects (Do NOT change!)
+static const QUuid kGuidNamespace(0x9d3b8a41, 0x5e0c, 0x4f8a, 0xa1, 0x6e, 0x2c, 0x47, 0x1b, 0x93, 0xd8, 0x05);
+
+QString MsvsPreparedProject::createGuid(const QString &key)
+{
+    return QUuid::createUuidV5(kGuidNamespace, key).toString().toUpper();
+}
+
+// Returns the file path of the primary target artifact in the build directory.
+static QString builtTargetFilePath(const ProductData &productData)
+{
+    static const QStringList primaryFileTags = {
+        QStringLiteral("application"),
+        QStringLiteral("dynamiclibrary"),
+        QStringLiteral("loadablemodule"),
+        QStringLiteral("staticlibrary")
+    };
+    const QList<ArtifactData> targetArtifacts = productData.targetArtifacts();
+    for (const QString &fileTag : primaryFileTags)
+        for (const ArtifactData &artifact : targetArtifacts)
+            if (artifact.fileTags().contains(fileTag))
+                return artifact.filePath();
+    return QString();
+}
+
 QList<QSharedPointer<MsvsPreparedProduct> > MsvsPreparedProject::allProducts() const
 {
     QList<QSharedPointer<MsvsPreparedProduct> > result = products.values();
@@ -57,19 +85,55 @@ QList<QSharedPointer<MsvsPreparedProduct> > MsvsPreparedProject::allProducts() c
     return result;
 }
 
+// Sub-project names are free text, so they are turned into names valid on Windows.
+static QString directoryName(const QString &name)
+{
+    static const QString invalidCharacters = QStringLiteral("<>:\"/\\|?*");
+    QString result = name;
+    for (QChar &c : result)
+        if (c < QLatin1Char(' ') || invalidCharacters.contains(c))
+            c = QLatin1Char('_');
+    while (result.endsWith(QLatin1Char('.')) || result.endsWith(QLatin1Char(' ')))
+        result.chop(1);
+    if (result.isEmpty())
+        result = QStringLiteral("_");
+    static const QRegExp reservedNames(QStringLiteral("CON|PRN|AUX|NUL|COM[1-9]|LPT[1-9]"), Qt::CaseInsensitive);
+    if (reservedNames.exactMatch(result.section(QLatin1Char('.'), 0, 0)))
+        result += QLatin1Char('_');
+    return result;
+}
+
+void MsvsPreparedProject::assignOutputSubdirectories(const QString &directory)
+{
+    for (const QSharedPointer<MsvsPreparedProduct> &product : products)
+        product->outputSubdirectory = directory;
+
+    // Windows file names are case-insensitive, so "Foo" and "foo" need different directories.
+    QSet<QString> usedNames;
+    for (auto it = subProjects.begin(); it != subProjects.end(); ++it) {
+        const QString baseName = directoryName(it.key());
+        QString name = baseName;
+        for (int i = 2; usedNames.contains(name.toLower()); ++i)
+            name = QStringLiteral("%1_%2").arg(baseName).arg(i);
+        usedNames.insert(name.toLower());
+        it.value().assignOutputSubdirectories(directory.isEmpty() ? name : directory + QLatin1Char('/') + name);
+    }
+}
+
 void MsvsPreparedProject::prepare(const Project& qbsProject,
                                   const InstallOptions& installOptions,
                                   const ProjectData& projectData,
-                                  const MsvsProjectConfiguration& config)
+                                  const MsvsProjectConfiguration& config,
+                                  const MsvsSelection &selection)
 {
     foreach (const ProjectData &subData, projectData.subProjects()) {
         if (!subProjects.contains(subData.name())) {
             MsvsPreparedProject subPrepared;
-            subPrepared.guid = QUuid::createUuid().toString();
+            subPrepared.guid = createGuid(QStringLiteral("project:%1/%2").arg(guid, subData.name()));
             subPrepared.name = subData.name();
             subProjects[subData.name()] = subPrepared;
         }
-        subProjects[subData.name()].prepare(qbsProject, installOptions, subData, config);
+        subProjects[subData.name()].prepare(qbsProject, installOptions, subData, config, selection);
     }
 
     if (!projectData.isEnabled() || !projectData.isValid() || projectData.products().isEmpty())
@@ -77,30 +141,110 @@ void MsvsPreparedProject::prepare(const Project& qbsProject,
 
     foreach (const ProductData &productData, projectData.products()) {
         if (!products.contains(productData.name())) {
+            const bool isSelected = selection.selectsProduct(productData.name());
+            if (!isSelected && selection.isShardWorker())
+                continue;
             QSharedPointer<MsvsPreparedProduct> product(new MsvsPreparedProduct());
-            product->guid = QUuid::createUuid().toString();
+            product->guid = createGuid(QStringLiteral("product:") + productData.name());
             product->name = productData.name();
-            QString buildDirectory = productData.properties().value(QStringLiteral("buildDirectory")).toString();
-            product->isApplication = productData.properties().value(QStringLiteral("type")).toStringList().contains(QStringLiteral("application"));
-            QString fullPath = qbsProject.targetExecutable(productData, installOptions);
-            if (!fullPath.isEmpty()) {
-                product->targetName = QFileInfo(fullPath).fileName();
-                product->targetPath = QFileInfo(fullPath).absolutePath();
-            } else {
-                product->targetName = productData.targetName();
-                product->targetPath = installOptions.installRoot();
-            }
-            if (product->targetPath.isEmpty())
-                product->targetPath = buildDirectory;
-            product->targetPath += QLatin1Char('/');
+            product->isSelected = isSelected;
             products.insert(product->name, product);
         }
-        products[productData.name()]->configurations[config] = productData;
+        // The solution needs only the configurations of unselected products.
+        QSharedPointer<MsvsPreparedProduct> &product = products[productData.name()];
+        if (!product->isSelected) {
+            product->configurations[config] = ProductData();
+            continue;
+        }
+        product->configurations[config] = productData;
+
+        product->isApplication = productData.properties().value(QStringLiteral("type")).toStringList().contains(QStringLiteral("application"));
+        MsvsProductProperties &properties = product->properties[config];
+        properties = MsvsProductProperties::fromProductData(productData);
+
+        // Profiles and variants may place the target differently, so it is kept per configuration.
+        const QString fullPath = config.usesBuildLocation()
+                ? builtTargetFilePath(productData)
+                : qbsProject.targetExecutable(productData, installOptions);
+        const QString buildDirectory = productData.properties().value(QStringLiteral("buildDirectory")).toString();
+        if (!fullPath.isEmpty()) {
+            properties.targetName = QFileInfo(fullPath).fileName();
+            properties.targetPath = QFileInfo(fullPath).absolutePath();
+        } else {
+            // Without an install step, nothing ever populates the install root.
+            properties.targetName = productData.targetName()
+                    + (product->isApplication ? properties.executableSuffix : QString());
+            properties.targetPath = config.usesBuildLocation() ? buildDirectory : installOptions.installRoot();
+        }
+        if (properties.targetPath.isEmpty())
+            properties.targetPath = buildDirectory;
+        properties.targetPath += QLatin1Char('/');
+
+        QStringList &buildSystemFiles = product->buildSystemFiles;
+        buildSystemFiles << productData.location().filePath();
+        foreach (const GroupData &groupData, productData.groups())
+            buildSystemFiles << groupData.location().filePath();
+        buildSystemFiles.removeAll(QString());
+        buildSystemFiles.removeDuplicates();
+        buildSystemFiles.sort();
     }
 
     enabledConfigurations << config;
 }
 
+static QList<QRegExp> wildcardPatterns(const QStringList &patterns)
+{
+    QList<QRegExp> result;
+    for (const QString &pattern : patterns)
+        result << QRegExp(pattern, Qt::CaseInsensitive, QRegExp::Wildcard);
+    return result;
+}
+
+static bool matchesAny(const QList<QRegExp> &patterns, const QStringList &names)
+{
+    for (const QRegExp &pattern : patterns)
+        for (const QString &name : names)
+            if (pattern.exactMatch(name))
+                return true;
+    return false;
+}
+
+MsvsSelection::MsvsSelection(const QStringList &productPatterns,
+                             const QStringList &configurationPatterns)
+    : m_productPatterns(wildcardPatterns(productPatterns))
+    , m_configurationPatterns(wildcardPatterns(configurationPatterns))
+{
+}
+
+void MsvsSelection::setShard(int shardIndex, int shardCount)
+{
+    m_shardIndex = shardIndex;
+    m_shardCount = shardCount;
+}
+
+bool MsvsSelection::isShardWorker() const
+{
+    return m_shardIndex >= 0 && m_shardCount > 1;
+}
+
+bool MsvsSelection::selectsProduct(const QString &productName) const
+{
+    if (m_shardIndex < 0)
+        return false;
+    if (m_shardCount > 1 && MsvsShards::shardOf(productName, m_shardCount) != m_shardIndex)
+        return false;
+    return m_productPatterns.isEmpty() || matchesAny(m_productPatterns, QStringList() << productName);
+}
+
+// Configurations match by their solution name ("profile-variant|platform"), the part before
+// the platform, or the build variant alone.
+bool MsvsSelection::selectsConfiguration(const MsvsProjectConfiguration &config) const
+{
+    return m_configurationPatterns.isEmpty()
+            || matchesAny(m_configurationPatterns, QStringList() << config.fullName()
+                          << config.profileAndVariant() << config.variant);
+}
+
 MsvsProjectConfiguration::MsvsProjectConfiguration()
 {
 }
@@ -162,6 +306,21 @@ QString MsvsProjectConfiguration::profileAndVariant() const
     return QStringLiteral("%1-%2").arg(cleanProfileName()).arg(variant);
 }
 
+QString MsvsProjectConfiguration::buildSubCommand() const
+{
+    return buildCommand == QStringLiteral("install") ? QStringLiteral("install") : QStringLiteral("build");
+}
+
+bool MsvsProjectConfiguration::installsOnBuild() const
+{
+    return buildCommand != QStringLiteral("build");
+}
+
+bool MsvsProjectConfiguration::usesBuildLocation() const
+{
+    return !installsOnBuild();
+}
+
 bool MsvsProjectConfiguration::operator<(const MsvsProjectConfiguration &right) const
 {
     return platform < right.platform
@@ -186,3 +345,10 @@ QStringList MsvsPreparedProduct::uniquePlatforms() const
         result << configuration.platform;
     return result.toList();
 }
+
+const MsvsProductProperties &MsvsPreparedProduct::propertiesFor(const MsvsProjectConfiguration &config) const
+{
+    const auto it = properties.constFind(config);
+    QBS_CHECK(it != properties.constEnd());
+    return it.value();
+}
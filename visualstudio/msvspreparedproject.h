@@ -31,8 +31,12 @@
 #ifndef MSVS_PREPARED_PROJECT_H
 #define MSVS_PREPARED_PROJECT_H
 
+#include "msvsproductproperties.h"
+
 #include <qbs.h>
 
+#include <QRegExp>
+
 namespace qbs
 {
     struct MsvsProjectConfiguration
@@ -46,6 +50,8 @@ namespace qbs
         QString buildDirectory;
         QString installRoot;
         QStringList commandLineParameters;
+        // One of "install", "build" and "incremental-install".
+        QString buildCommand = QStringLiteral("install");
         bool useSimplifiedConfigurationNames = false;
 
         MsvsProjectConfiguration();
@@ -58,6 +64,11 @@ namespace qbs
         QString cleanProfileName() const;
         QString fullName() const;
         QString profileAndVariant() const;
+        // The qbs command run on build, and whether it installs.
+        QString buildSubCommand() const;
+        bool installsOnBuild() const;
+        // Whether the debugger runs the target from the build directory.
+        bool usesBuildLocation() const;
         bool operator<(const MsvsProjectConfiguration &right) const;
         bool operator==(const MsvsProjectConfiguration &right) const;
     };
@@ -67,12 +78,59 @@ namespace qbs
     struct MsvsPreparedProduct
     {
         QMap<MsvsProjectConfiguration, ProductData> configurations;
+        QMap<MsvsProjectConfiguration, MsvsProductProperties> properties;
         QString name;
-        QString targetName;
-        QString targetPath;
         QString guid;
-        bool isApplication;
+        bool isApplication = false;
+        // Unselected products are kept in the solution only, and neither prepared nor written.
+        bool isSelected = true;
+        // Written by the worker process of another shard.
+        bool isWrittenByShard = false;
+        // The qbs files declaring the product, in all configurations.
+        QStringList buildSystemFiles;
+        // The directory of the project files relative to the solution, empty for the flat layout.
+        QString outputSubdirectory;
         QStringList uniquePlatforms() const;
+        const MsvsProductProperties &propertiesFor(const MsvsProjectConfiguration &config) const;
+    };
+
+    // Selects the products and configurations to generate by wildcard patterns.
+    // An empty pattern list selects everything.
+    class MsvsSelection
+    {
+    public:
+        MsvsSelection(const QStringList &productPatterns = QStringList(),
+                      const QStringList &configurationPatterns = QStringList());
+        // Restricts the products to those of one shard. An index of -1 selects no product.
+        void setShard(int shardIndex, int shardCount);
+        // A shard worker writes no solution, so it skips the products it does not select.
+        bool isShardWorker() const;
+        bool selectsProduct(const QString &productName) const;
+        bool selectsConfiguration(const MsvsProjectConfiguration &config) const;
+
+    private:
+        QList<QRegExp> m_productPatterns;
+        QList<QRegExp> m_configurationPatterns;
+        int m_shardIndex = 0;
+        int m_shardCount = 1;
+    };
+
+    // The check project which regenerates the solution when the qbs files changed.
+    struct MsvsRegenerateProject
+    {
+        QString name;
+        QString guid;
+        QString generatorName;
+        QString stampFilePath;
+        QStringList buildSystemFiles;
+        QMap<QString, QString> environment;
+    };
+
+    // The utility project building all configurations in one qbs invocation.
+    struct MsvsBatchBuildProject
+    {
+        QString name;
+        QString guid;
     };
 
     struct MsvsPreparedProject
@@ -84,10 +142,15 @@ namespace qbs
         QMap<QString, QSharedPointer<MsvsPreparedProduct>> products;
 
         QList<QSharedPointer<MsvsPreparedProduct>> allProducts() const;
+        // Name-based, so that the GUIDs are stable between generator runs.
+        static QString createGuid(const QString &key);
         void prepare(const Project &qbsProject,
                      const InstallOptions &installOptions,
                      const ProjectData &projectData,
-                     const MsvsProjectConfiguration &config);
+                     const MsvsProjectConfiguration &config,
+                     const MsvsSelection &selection = MsvsSelection());
+        // Lays out the project files in directories mirroring the sub-project tree.
+        void assignOutputSubdirectories(const QString &directory = QString());
     };
 }
 
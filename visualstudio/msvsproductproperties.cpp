@@ -0,0 +1,210 @@
+/****************************************************************************
+**
+** Copyright (C) 2015 The Qt Company Ltd.
+** Contact: http://www.qt.io/licensing
+**
+** This file is part of the Qt Build Suite.
+**
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms and
+** conditions see http://www.qt.io/terms-conditions. For further information
+** use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file.  Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, The Qt Company gives you certain additional
+** rights.  These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+****************************************************************************/
+
+
+#include "msvsproductproperties.h"
+
+#include <qbs.h>
+
+#include <QCryptographicHash>
+#include <QFileInfo>
+
+namespace qbs {
+
+namespace {
+
+template <typename T>
+struct PropertyMapping
+{
+    const char *module;
+    const char *name;
+    T MsvsProductProperties::*field;
+    bool isPath; // file system paths are made relative for relocatable output
+};
+
+// Adding a property the writers need is a matter of adding a field and a table entry.
+constexpr PropertyMapping<bool> kBoolProperties[] = {
+    {"qbs", "debugInformation", &MsvsProductProperties::debugInformation, false},
+    {"cpp", "useCxxPrecompiledHeader", &MsvsProductProperties::useCxxPrecompiledHeader, false}
+};
+
+constexpr PropertyMapping<QString> kStringProperties[] = {
+    {"qbs", "optimization", &MsvsProductProperties::optimization, false},
+    {"qbs", "warningLevel", &MsvsProductProperties::warningLevel, false},
+    {"qbs", "executableSuffix", &MsvsProductProperties::executableSuffix, false},
+    {"cpp", "windowsApiCharacterSet", &MsvsProductProperties::windowsApiCharacterSet, false},
+    {"cpp", "cxxPrecompiledHeader", &MsvsProductProperties::cxxPrecompiledHeader, true},
+    {"cpp", "precompiledHeader", &MsvsProductProperties::precompiledHeader, true}
+};
+
+// Scalar properties which may also be given as lists.
+constexpr PropertyMapping<QStringList> kVariantListProperties[] = {
+    {"cpp", "cxxLanguageVersion", &MsvsProductProperties::cxxLanguageVersion, false},
+    {"cpp", "cLanguageVersion", &MsvsProductProperties::cLanguageVersion, false}
+};
+
+// List properties merged from all modules.
+constexpr PropertyMapping<QStringList> kListProperties[] = {
+    {"cpp", "includePaths", &MsvsProductProperties::includePaths, true},
+    {"cpp", "systemIncludePaths", &MsvsProductProperties::systemIncludePaths, true},
+    {"cpp", "defines", &MsvsProductProperties::defines, false},
+    {"cpp", "staticLibraries", &MsvsProductProperties::staticLibraries, true},
+    {"cpp", "libraryPaths", &MsvsProductProperties::libraryPaths, true},
+    {"cpp", "prefixHeaders", &MsvsProductProperties::prefixHeaders, true},
+    {"cpp", "commonCompilerFlags", &MsvsProductProperties::commonCompilerFlags, false},
+    {"cpp", "cxxFlags", &MsvsProductProperties::cxxFlags, false}
+};
+
+} // namespace
+
+// Maps qbs language versions ("c++14", "c11", ...) to the MSVC /std: switch value.
+// Versions older than the MSVC default are not mapped, as the compiler has no switch for them.
+static QString msvcLanguageStandard(const QStringList &languageVersions)
+{
+    static const QList<QPair<QString, QString> > map {
+        {QStringLiteral("c++2a"), QStringLiteral("c++latest")},
+        {QStringLiteral("c++20"), QStringLiteral("c++latest")},
+        {QStringLiteral("c++1z"), QStringLiteral("c++17")},
+        {QStringLiteral("c++17"), QStringLiteral("c++17")},
+        {QStringLiteral("c++14"), QStringLiteral("c++14")},
+        {QStringLiteral("c18"), QStringLiteral("c17")},
+        {QStringLiteral("c17"), QStringLiteral("c17")},
+        {QStringLiteral("c11"), QStringLiteral("c11")}
+    };
+    for (const auto &entry : map) // ordered from the newest standard, as qbs does
+        if (languageVersions.contains(entry.first))
+            return entry.second;
+    return QString();
+}
+
+// Splits compiler flags into the options VS has dedicated properties for.
+// Everything else is passed to IntelliSense as is.
+static void parseCompilerFlags(const QStringList &flags, MsvsProductProperties &properties,
+                               QString &precompiledHeaderFlag, QStringList &forcedIncludeFlags)
+{
+    for (int i = 0; i < flags.size(); ++i) {
+        const QString &flag = flags.at(i);
+        if (!flag.startsWith(QLatin1Char('/')) && !flag.startsWith(QLatin1Char('-'))) {
+            properties.additionalCompilerOptions << flag;
+            continue;
+        }
+
+        const QString option = flag.mid(1);
+        QString value;
+        if (option.startsWith(QStringLiteral("std:"))) {
+            value = option.mid(4);
+            if (value.startsWith(QStringLiteral("c++")))
+                properties.cxxStandard = value;
+            else
+                properties.cStandard = value;
+        } else if (option.startsWith(QStringLiteral("FI")) || option.startsWith(QStringLiteral("Yu"))) {
+            value = option.mid(2);
+            if (value.isEmpty() && i + 1 < flags.size())
+                value = flags.at(++i);
+            if (option.startsWith(QStringLiteral("FI")))
+                forcedIncludeFlags << value;
+            else
+                precompiledHeaderFlag = value;
+        } else {
+            properties.additionalCompilerOptions << flag;
+        }
+    }
+}
+
+MsvsProductProperties MsvsProductProperties::fromProductData(const ProductData &productData)
+{
+    MsvsProductProperties result;
+    const PropertyMap properties = productData.moduleProperties();
+
+    for (const auto &mapping : kBoolProperties) {
+        const QVariant value = properties.getModuleProperty(QLatin1String(mapping.module), QLatin1String(mapping.name));
+        if (value.isValid())
+            result.*mapping.field = value.toBool();
+    }
+    for (const auto &mapping : kStringProperties)
+        result.*mapping.field = properties.getModuleProperty(QLatin1String(mapping.module), QLatin1String(mapping.name)).toString();
+    for (const auto &mapping : kVariantListProperties)
+        result.*mapping.field = properties.getModuleProperty(QLatin1String(mapping.module), QLatin1String(mapping.name)).toStringList();
+    for (const auto &mapping : kListProperties)
+        result.*mapping.field = properties.getModulePropertiesAsStringList(QLatin1String(mapping.module), QLatin1String(mapping.name));
+
+    result.allIncludePaths = QStringList() << result.includePaths << result.systemIncludePaths;
+
+    QString precompiledHeaderFlag;
+    QStringList forcedIncludeFlags;
+    parseCompilerFlags(QStringList() << result.commonCompilerFlags << result.cxxFlags,
+                       result, precompiledHeaderFlag, forcedIncludeFlags);
+
+    // Explicit flags win over the language version properties, as they are passed last to the compiler.
+    if (result.cxxStandard.isEmpty())
+        result.cxxStandard = msvcLanguageStandard(result.cxxLanguageVersion);
+    if (result.cStandard.isEmpty())
+        result.cStandard = msvcLanguageStandard(result.cLanguageVersion);
+
+    // qbs force-includes the precompiled header, so it goes first into the forced includes.
+    QString precompiledHeader = !result.cxxPrecompiledHeader.isEmpty()
+            ? result.cxxPrecompiledHeader : result.precompiledHeader;
+    if (!result.useCxxPrecompiledHeader)
+        precompiledHeader.clear();
+    if (!precompiledHeader.isEmpty())
+        result.forcedIncludes << precompiledHeader;
+    result.forcedIncludes << result.prefixHeaders << forcedIncludeFlags;
+    result.forcedIncludes.removeDuplicates();
+    result.precompiledHeaderFile = !precompiledHeaderFlag.isEmpty()
+            ? precompiledHeaderFlag : QFileInfo(precompiledHeader).fileName();
+
+    return result;
+}
+
+void MsvsProductProperties::addToHash(QCryptographicHash &hash,
+                                      const std::function<QString(const QString &)> &mapPath) const
+{
+    const auto addString = [&](const QString &value, bool isPath) {
+        hash.addData((isPath ? mapPath(value) : value).toUtf8().append('\0'));
+    };
+    const auto addList = [&](const QStringList &values, bool isPath) {
+        for (const QString &value : values)
+            addString(value, isPath);
+        hash.addData("\n", 1);
+    };
+
+    for (const auto &mapping : kBoolProperties)
+        hash.addData(this->*mapping.field ? "1" : "0", 1);
+    for (const auto &mapping : kStringProperties)
+        addString(this->*mapping.field, mapping.isPath);
+    for (const auto &mapping : kVariantListProperties)
+        addList(this->*mapping.field, mapping.isPath);
+    for (const auto &mapping : kListProperties)
+        addList(this->*mapping.field, mapping.isPath);
+    addString(targetName, false);
+    addString(targetPath, true);
+}
+
+} // namespace qbs
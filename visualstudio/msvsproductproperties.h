@@ -0,0 +1,97 @@
+/****************************************************************************
+**
+** Copyright (C) 2015 The Qt Company Ltd.
+** Contact: http://www.qt.io/licensing
+**
+** This file is part of the Qt Build Suite.
+**
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms and
+** conditions see http://www.qt.io/terms-conditions. For further information
+** use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file.  Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, The Qt Company gives you certain additional
+** rights.  These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+****************************************************************************/
+
+
+#ifndef QBS_MSVSPRODUCTPROPERTIES_H
+#define QBS_MSVSPRODUCTPROPERTIES_H
+
+#include <QStringList>
+
+#include <functional>
+
+QT_BEGIN_NAMESPACE
+class QCryptographicHash;
+QT_END_NAMESPACE
+
+namespace qbs {
+
+class ProductData;
+
+/*!
+ * \brief The MsvsProductProperties struct holds the module properties of one product
+ * configuration the project writers need. They are extracted once per ProductData
+ * through the mapping table in msvsproductproperties.cpp and shared by all writers.
+ */
+struct MsvsProductProperties
+{
+    // Mapped module properties
+    bool debugInformation = false;
+    QString optimization;
+    QString warningLevel;
+    QString executableSuffix;
+    QString windowsApiCharacterSet;
+    QStringList includePaths;
+    QStringList systemIncludePaths;
+    QStringList defines;
+    QStringList staticLibraries;
+    QStringList libraryPaths;
+    QStringList prefixHeaders;
+    QStringList commonCompilerFlags;
+    QStringList cxxFlags;
+    QStringList cxxLanguageVersion;
+    QStringList cLanguageVersion;
+    QString cxxPrecompiledHeader;
+    QString precompiledHeader;
+    bool useCxxPrecompiledHeader = true;
+
+    // Derived values
+    QStringList allIncludePaths;
+    QString cxxStandard; // MSVC /std: value, e.g. "c++17"
+    QString cStandard;
+    QString precompiledHeaderFile; // header name for /Yu
+    QStringList forcedIncludes;
+    QStringList additionalCompilerOptions; // flags VS has no dedicated property for
+
+    // Target, set by MsvsPreparedProject::prepare()
+    QString targetName; // file name, including the executable suffix
+    QString targetPath; // directory, with a trailing slash
+
+    // Adds the mapped properties and the target to a fingerprint; the derived values follow
+    // from them.
+    // Path properties are added as returned by mapPath.
+    void addToHash(QCryptographicHash &hash,
+                   const std::function<QString(const QString &)> &mapPath) const;
+
+    static MsvsProductProperties fromProductData(const ProductData &productData);
+};
+
+} // namespace qbs
+
+#endif // QBS_MSVSPRODUCTPROPERTIES_H
@@ -0,0 +1,97 @@
+/****************************************************************************
+**
+** Copyright (C) 2015 The Qt Company Ltd.
+** Contact: http://www.qt.io/licensing
+**
+** This file is part of the Qt Build Suite.
+**
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms and
+** conditions see http://www.qt.io/terms-conditions. For further information
+** use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file.  Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, The Qt Company gives you certain additional
+** rights.  These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+****************************************************************************/
+
+
+#include "msvsprogress.h"
+
+#include <logging/translator.h>
+#include <tools/error.h>
+
+#include <QMutexLocker>
+
+namespace qbs {
+
+using namespace Internal;
+
+void MsvsProgress::setCallback(const Callback &callback)
+{
+    QMutexLocker locker(&m_mutex);
+    m_callback = callback;
+}
+
+void MsvsProgress::beginPhase(const QString &phase, int total)
+{
+    QMutexLocker locker(&m_mutex);
+    m_info = MsvsProgressInfo();
+    m_info.phase = phase;
+    m_info.total = total;
+    m_timer.start();
+    report();
+}
+
+void MsvsProgress::advance()
+{
+    QMutexLocker locker(&m_mutex);
+    ++m_info.done;
+    report();
+}
+
+void MsvsProgress::cancel()
+{
+    m_canceled = true;
+}
+
+void MsvsProgress::resetCancellation()
+{
+    m_canceled = false;
+}
+
+bool MsvsProgress::isCanceled() const
+{
+    return m_canceled;
+}
+
+void MsvsProgress::checkCanceled() const
+{
+    if (m_canceled)
+        throw ErrorInfo(Tr::tr("Generation canceled"));
+}
+
+void MsvsProgress::report()
+{
+    if (!m_callback)
+        return;
+    m_info.elapsedMilliseconds = m_timer.elapsed();
+    m_info.throughput = m_info.elapsedMilliseconds > 0
+            ? m_info.done * 1000.0 / m_info.elapsedMilliseconds : 0;
+    m_callback(m_info);
+}
+
+} // namespace qbs
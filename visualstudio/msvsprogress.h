@@ -0,0 +1,88 @@
+/****************************************************************************
+**
+** Copyright (C) 2015 The Qt Company Ltd.
+** Contact: http://www.qt.io/licensing
+**
+** This file is part of the Qt Build Suite.
+**
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms and
+** conditions see http://www.qt.io/terms-conditions. For further information
+** use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file.  Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, The Qt Company gives you certain additional
+** rights.  These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+****************************************************************************/
+
+
+#ifndef QBS_MSVSPROGRESS_H
+#define QBS_MSVSPROGRESS_H
+
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QString>
+
+#include <atomic>
+#include <functional>
+
+namespace qbs {
+
+struct MsvsProgressInfo
+{
+    QString phase;
+    int done = 0;
+    int total = 0;
+    qint64 elapsedMilliseconds = 0;
+    // Items per second in the current phase.
+    double throughput = 0;
+};
+
+/*!
+ * \brief The MsvsProgress class reports the progress of a generation and carries its
+ * cancellation request. Workers call advance() for each finished item and checkCanceled()
+ * before starting a new one. The callback is invoked from the worker threads, but never
+ * concurrently.
+ */
+class MsvsProgress
+{
+public:
+    typedef std::function<void(const MsvsProgressInfo &info)> Callback;
+
+    void setCallback(const Callback &callback);
+
+    void beginPhase(const QString &phase, int total);
+    void advance();
+
+    void cancel();
+    void resetCancellation();
+    bool isCanceled() const;
+    // Throws an ErrorInfo if the generation was canceled.
+    void checkCanceled() const;
+
+private:
+    void report();
+
+    QMutex m_mutex;
+    Callback m_callback;
+    MsvsProgressInfo m_info;
+    QElapsedTimer m_timer;
+    std::atomic<bool> m_canceled{false};
+};
+
+} // namespace qbs
+
+#endif // QBS_MSVSPROGRESS_H
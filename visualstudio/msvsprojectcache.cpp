@@ -0,0 +1,168 @@
+/****************************************************************************
+**
+** Copyright (C) 2015 The Qt Company Ltd.
+** Contact: http://www.qt.io/licensing
+**
+** This file is part of the Qt Build Suite.
+**
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms and
+** conditions see http://www.qt.io/terms-conditions. For further information
+** use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file.  Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, The Qt Company gives you certain additional
+** rights.  These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+****************************************************************************/
+
+
+#include "msvsprojectcache.h"
+#include "msvsstagedoutput.h"
+#include "msvsstatistics.h"
+#include "visualstudioxmlprojectwriter.h"
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+
+namespace qbs {
+
+// Bump on every change of the rendered output which is not covered by the fingerprint.
+static const char kCacheFormatVersion[] = "qbs-msvs-cache-5";
+
+MsvsProjectCache::MsvsProjectCache(const QString &directory)
+    : m_directory(directory)
+{
+}
+
+bool MsvsProjectCache::isEnabled() const
+{
+    return !m_directory.isEmpty();
+}
+
+static void addString(QCryptographicHash &hash, const QString &value)
+{
+    hash.addData(value.toUtf8().append('\0'));
+}
+
+QByteArray MsvsProjectCache::fingerprint(const VisualStudioXmlProjectWriter &writer,
+                                         const MsvsPreparedProduct &product,
+                                         const QString &baseBuildDirectory) const
+{
+    const QString projectDirectory = QFileInfo(writer.targetFilePath(product, baseBuildDirectory)).path();
+    const auto mapPath = [&](const QString &path) { return writer.projectPath(path, projectDirectory); };
+
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(kCacheFormatVersion);
+    addString(hash, writer.versionInfo().marketingVersion());
+    addString(hash, writer.projectFileExtension());
+    hash.addData(writer.options().relativePaths ? "relative" : "absolute");
+    hash.addData(writer.options().buildTiming ? "timing" : "direct");
+    hash.addData(writer.options().qtItemTypes ? "qt" : "plain");
+    addString(hash, writer.options().jobs);
+    addString(hash, QString::number(writer.options().jobPoolSize));
+
+    addString(hash, product.name);
+    addString(hash, product.guid);
+    hash.addData(product.isApplication ? "1" : "0", 1);
+    for (const QString &filePath : product.buildSystemFiles)
+        addString(hash, mapPath(filePath));
+
+    for (auto it = product.configurations.cbegin(); it != product.configurations.cend(); ++it) {
+        const MsvsProjectConfiguration &buildTask = it.key();
+        addString(hash, buildTask.fullName());
+        addString(hash, buildTask.profile);
+        addString(hash, mapPath(buildTask.qbsExecutablePath));
+        addString(hash, mapPath(buildTask.qbsProjectFile));
+        addString(hash, mapPath(buildTask.buildDirectory));
+        addString(hash, mapPath(buildTask.installRoot));
+        addString(hash, buildTask.buildCommand);
+        for (const QString &parameter : buildTask.commandLineParameters)
+            addString(hash, parameter);
+
+        addString(hash, it.value().targetName());
+        product.propertiesFor(buildTask).addToHash(hash, mapPath);
+
+        for (const GroupData &groupData : it.value().groups()) {
+            if (!groupData.isEnabled())
+                continue;
+            for (const ArtifactData &artifact : groupData.allSourceArtifacts()) {
+                addString(hash, mapPath(artifact.filePath()));
+                for (const QString &fileTag : artifact.fileTags())
+                    addString(hash, fileTag);
+            }
+        }
+        hash.addData("\n", 1);
+    }
+
+    return hash.result().toHex();
+}
+
+QString MsvsProjectCache::entryFilePath(const QByteArray &fingerprint, int index) const
+{
+    return QDir(m_directory).absoluteFilePath(QStringLiteral("%1/%2.%3")
+                                              .arg(QString::fromLatin1(fingerprint.left(2)))
+                                              .arg(QString::fromLatin1(fingerprint))
+                                              .arg(index));
+}
+
+bool MsvsProjectCache::restore(const QByteArray &fingerprint, const QStringList &filePaths) const
+{
+    QList<QByteArray> contents;
+    for (int i = 0; i < filePaths.size(); ++i) {
+        QFile entry(entryFilePath(fingerprint, i));
+        if (!entry.open(QIODevice::ReadOnly))
+            return false;
+        contents << entry.readAll();
+    }
+
+    qint64 bytes = 0;
+    for (int i = 0; i < filePaths.size(); ++i) {
+        if (!MsvsStagedOutput::instance().writeFile(filePaths.at(i), contents.at(i)))
+            return false;
+        bytes += contents.at(i).size();
+    }
+    MsvsStatistics::instance().recordCacheRestore(filePaths.size(), bytes);
+    return true;
+}
+
+// Entries are written to a temporary file and renamed, so agents sharing
+// the cache directory never see partially written entries.
+void MsvsProjectCache::store(const QByteArray &fingerprint, const QStringList &filePaths) const
+{
+    for (int i = 0; i < filePaths.size(); ++i) {
+        const QString entryPath = entryFilePath(fingerprint, i);
+        if (QFileInfo(entryPath).exists())
+            continue;
+        if (!QDir().mkpath(QFileInfo(entryPath).path()))
+            return;
+
+        QByteArray contents;
+        if (!MsvsStagedOutput::instance().readFile(filePaths.at(i), &contents))
+            return;
+
+        QSaveFile entry(entryPath);
+        if (!entry.open(QIODevice::WriteOnly))
+            return;
+        entry.write(contents);
+        if (!entry.commit())
+            return;
+    }
+}
+
+} // namespace qbs
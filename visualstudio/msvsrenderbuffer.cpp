@@ -0,0 +1,67 @@
+/****************************************************************************
+**
+** Copyright (C) 2015 The Qt Company Ltd.
+** Contact: http://www.qt.io/licensing
+**
+** This file is part of the Qt Build Suite.
+**
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms and
+** conditions see http://www.qt.io/terms-conditions. For further information
+** use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file.  Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, The Qt Company gives you certain additional
+** rights.  These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+****************************************************************************/
+
+
+#include "msvsrenderbuffer.h"
+
+#include <tools/qbsassert.h>
+
+namespace qbs {
+
+// Larger buffers are released after use, so that one huge product does not pin its
+// buffer in every thread for the rest of the generation.
+static const int kMaxRetainedCapacity = 16 * 1024 * 1024;
+
+static thread_local QByteArray threadBuffer;
+static thread_local bool threadBufferInUse = false;
+
+MsvsRenderBuffer::MsvsRenderBuffer()
+{
+    QBS_CHECK(!threadBufferInUse);
+    threadBufferInUse = true;
+    // reserve() marks the capacity as reserved, so that emptying the buffer keeps it.
+    threadBuffer.reserve(threadBuffer.capacity());
+    threadBuffer.resize(0);
+    m_device.setBuffer(&threadBuffer);
+    m_device.open(QIODevice::WriteOnly);
+}
+
+MsvsRenderBuffer::~MsvsRenderBuffer()
+{
+    m_device.close();
+    m_device.setBuffer(nullptr);
+    if (threadBuffer.capacity() > kMaxRetainedCapacity)
+        threadBuffer = QByteArray();
+    else
+        threadBuffer.resize(0);
+    threadBufferInUse = false;
+}
+
+} // namespace qbs
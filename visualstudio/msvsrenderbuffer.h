@@ -0,0 +1,63 @@
+/****************************************************************************
+**
+** Copyright (C) 2015 The Qt Company Ltd.
+** Contact: http://www.qt.io/licensing
+**
+** This file is part of the Qt Build Suite.
+**
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms and
+** conditions see http://www.qt.io/terms-conditions. For further information
+** use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file.  Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, The Qt Company gives you certain additional
+** rights.  These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+****************************************************************************/
+
+
+#ifndef QBS_MSVSRENDERBUFFER_H
+#define QBS_MSVSRENDERBUFFER_H
+
+#include <QBuffer>
+
+namespace qbs {
+
+/*!
+ * \brief The MsvsRenderBuffer class provides the buffer a project file is rendered into.
+ * Every worker thread owns one buffer, which keeps its capacity from product to product,
+ * so that rendering does not regrow a buffer for each file. The rendered file is then
+ * handed to the output with a single call. Only one MsvsRenderBuffer may exist per thread at a time.
+ */
+class MsvsRenderBuffer
+{
+public:
+    MsvsRenderBuffer();
+    ~MsvsRenderBuffer();
+
+    QIODevice *device() { return &m_device; }
+    qint64 size() const { return m_device.data().size(); }
+    qint64 capacity() const { return m_device.data().capacity(); }
+    const QByteArray &data() const { return m_device.data(); }
+
+private:
+    Q_DISABLE_COPY(MsvsRenderBuffer)
+    QBuffer m_device;
+};
+
+} // namespace qbs
+
+#endif // QBS_MSVSRENDERBUFFER_H
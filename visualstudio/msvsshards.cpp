@@ -0,0 +1,169 @@
+/****************************************************************************
+**
+** Copyright (C) 2015 The Qt Company Ltd.
+** Contact: http://www.qt.io/licensing
+**
+** This file is part of the Qt Build Suite.
+**
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms and
+** conditions see http://www.qt.io/terms-conditions. For further information
+** use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file.  Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, The Qt Company gives you certain additional
+** rights.  These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+****************************************************************************/
+
+
+#include "msvsshards.h"
+#include "msvsprogress.h"
+#include "msvsstagedoutput.h"
+
+#include <logging/translator.h>
+#include <tools/error.h>
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QProcess>
+#include <QSaveFile>
+
+#include <memory>
+#include <vector>
+
+namespace qbs {
+
+// qHash() is not guaranteed to be stable between processes, so the partitioning uses SHA-1.
+int MsvsShards::shardOf(const QString &productName, int shardCount)
+{
+    const QByteArray hash = QCryptographicHash::hash(productName.toUtf8(), QCryptographicHash::Sha1);
+    const quint32 value = (quint32(uchar(hash.at(0))) << 24) | (quint32(uchar(hash.at(1))) << 16)
+            | (quint32(uchar(hash.at(2))) << 8) | quint32(uchar(hash.at(3)));
+    return int(value % quint32(shardCount));
+}
+
+QString MsvsShards::summaryFilePath(const QString &buildDirectory, int shardIndex, int shardCount)
+{
+    return QDir(buildDirectory).absoluteFilePath(QStringLiteral("qbs-msvs-shard-%1-of-%2.json")
+                                                 .arg(shardIndex).arg(shardCount));
+}
+
+QString MsvsShards::journalFilePath(const QString &buildDirectory, int shardIndex, int shardCount)
+{
+    return QDir(buildDirectory).absoluteFilePath(QStringLiteral("qbs-msvs-shard-%1-of-%2.staged")
+                                                 .arg(shardIndex).arg(shardCount));
+}
+
+bool MsvsShards::writeSummary(const QString &filePath, int shardIndex, int shardCount,
+                              const QStringList &productNames)
+{
+    QJsonObject summary;
+    summary.insert(QStringLiteral("shard"), shardIndex);
+    summary.insert(QStringLiteral("shards"), shardCount);
+    summary.insert(QStringLiteral("products"), QJsonArray::fromStringList(productNames));
+
+    // Written in place, as it tells the coordinator that the shard completed.
+    QSaveFile file(filePath);
+    return file.open(QIODevice::WriteOnly) && file.write(QJsonDocument(summary).toJson()) >= 0
+            && file.commit();
+}
+
+bool MsvsShards::readSummary(const QString &filePath, int shardIndex, int shardCount,
+                             QStringList *productNames)
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+    const QJsonObject summary = QJsonDocument::fromJson(file.readAll()).object();
+    if (summary.value(QStringLiteral("shard")).toInt(-1) != shardIndex
+            || summary.value(QStringLiteral("shards")).toInt(-1) != shardCount) {
+        return false;
+    }
+    for (const QJsonValue &value : summary.value(QStringLiteral("products")).toArray())
+        *productNames << value.toString();
+    return true;
+}
+
+// The output of the workers goes to the console of this process.
+void MsvsShards::runWorkers(const QString &qbsExecutable, const QStringList &arguments,
+                            const QString &buildDirectory, int shardCount, const MsvsProgress &progress)
+{
+    // Leftovers of an earlier run must not be taken for the results of this one.
+    for (int i = 0; i < shardCount; ++i) {
+        QFile::remove(summaryFilePath(buildDirectory, i, shardCount));
+        QFile::remove(journalFilePath(buildDirectory, i, shardCount));
+    }
+
+    std::vector<std::unique_ptr<QProcess> > workers;
+    for (int i = 0; i < shardCount; ++i) {
+        QProcessEnvironment environment = QProcessEnvironment::systemEnvironment();
+        environment.insert(QStringLiteral("QBS_MSVS_SHARD"), QString::number(i));
+        environment.insert(QStringLiteral("QBS_MSVS_SHARDS"), QString::number(shardCount));
+
+        std::unique_ptr<QProcess> worker(new QProcess);
+        worker->setProcessEnvironment(environment);
+        worker->setProcessChannelMode(QProcess::ForwardedChannels);
+        worker->start(qbsExecutable, arguments);
+        workers.push_back(std::move(worker));
+    }
+
+    // A worker killed before it created its journal has staged nothing.
+    const auto adoptJournals = [&]() {
+        bool adopted = true;
+        for (int i = 0; i < shardCount; ++i) {
+            const QString journalFilePath = MsvsShards::journalFilePath(buildDirectory, i, shardCount);
+            if (!MsvsStagedOutput::instance().adoptJournal(journalFilePath))
+                adopted = false;
+        }
+        return adopted;
+    };
+    const auto killWorkers = [&]() {
+        for (const std::unique_ptr<QProcess> &worker : workers) {
+            worker->kill();
+            worker->waitForFinished();
+        }
+        adoptJournals();
+    };
+
+    for (int i = 0; i < shardCount; ++i) {
+        QProcess &worker = *workers.at(i);
+        if (!worker.waitForStarted()) {
+            killWorkers();
+            throw ErrorInfo(Tr::tr("Failed to start the worker of shard %1: %2")
+                            .arg(i).arg(worker.errorString()));
+        }
+        while (!worker.waitForFinished(100)) {
+            if (progress.isCanceled()) {
+                killWorkers();
+                progress.checkCanceled();
+            }
+            if (worker.state() == QProcess::NotRunning)
+                break;
+        }
+        if (worker.exitStatus() != QProcess::NormalExit || worker.exitCode() != 0) {
+            killWorkers();
+            throw ErrorInfo(Tr::tr("The worker of shard %1 of %2 failed").arg(i).arg(shardCount));
+        }
+    }
+    if (!adoptJournals())
+        throw ErrorInfo(Tr::tr("Failed to take over the files staged by the shard workers"));
+}
+
+} // namespace qbs
@@ -0,0 +1,78 @@
+/****************************************************************************
+**
+** Copyright (C) 2015 The Qt Company Ltd.
+** Contact: http://www.qt.io/licensing
+**
+** This file is part of the Qt Build Suite.
+**
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms and
+** conditions see http://www.qt.io/terms-conditions. For further information
+** use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file.  Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, The Qt Company gives you certain additional
+** rights.  These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+****************************************************************************/
+
+
+#ifndef QBS_MSVSSHARDS_H
+#define QBS_MSVSSHARDS_H
+
+#include <QStringList>
+
+namespace qbs {
+
+class MsvsProgress;
+
+/*!
+ * \brief The MsvsShards class splits a generation over several worker processes.
+ * The products are partitioned by a stable hash of their names. The coordinating process
+ * starts one "qbs generate" worker per shard for the same project. Each worker prepares and stages
+ * the project files of its own products only, lists the staged files in a journal, and then
+ * writes a small summary listing the products. The coordinator itself prepares no product data,
+ * writes the solution from the summaries, and commits the files of all shards together with
+ * its own, so that a failed, canceled or killed worker leaves the previous outputs intact.
+ * Each process still loads the whole resolved project from qbs, which the generator cannot
+ * restrict. The peak memory of a worker is therefore that of the resolved project plus about
+ * 1/K of the prepared data and rendered output, and only the latter shrinks with the
+ * number of shards K.
+ */
+class MsvsShards
+{
+public:
+    static int shardOf(const QString &productName, int shardCount);
+
+    static QString summaryFilePath(const QString &buildDirectory, int shardIndex, int shardCount);
+    static QString journalFilePath(const QString &buildDirectory, int shardIndex, int shardCount);
+    static bool writeSummary(const QString &filePath, int shardIndex, int shardCount,
+                             const QStringList &productNames);
+    // Returns false for a missing summary or one of another partitioning.
+    static bool readSummary(const QString &filePath, int shardIndex, int shardCount,
+                            QStringList *productNames);
+
+    // Runs all workers in parallel and adopts their staged files for the commit of this process.
+    // Throws an ErrorInfo if one of them fails. Cancellation kills the workers. Either way, the
+    // files staged so far are adopted, so that discarding the generation removes them.
+    // The workers run qbsExecutable with the given arguments, and learn their shard from
+    // QBS_MSVS_SHARD.
+    static void runWorkers(const QString &qbsExecutable, const QStringList &arguments,
+                           const QString &buildDirectory, int shardCount, const MsvsProgress &progress);
+};
+
+} // namespace qbs
+
+#endif // QBS_MSVSSHARDS_H
@@ -0,0 +1,391 @@
+/****************************************************************************
+**
+** Copyright (C) 2015 The Qt Company Ltd.
+** Contact: http://www.qt.io/licensing
+**
+** This file is part of the Qt Build Suite.
+**
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms and
+** conditions see http://www.qt.io/terms-conditions. For further information
+** use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file.  Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, The Qt Company gives you certain additional
+** rights.  These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+****************************************************************************/
+
+
+#include "msvsstagedoutput.h"
+#include "msvsstatistics.h"
+
+#include <tools/qbsassert.h>
+
+#include <QDateTime>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QMutexLocker>
+#include <QSaveFile>
+
+#include <cstdio>
+#include <cstring>
+
+namespace qbs {
+
+MsvsStagedOutput &MsvsStagedOutput::instance()
+{
+    static MsvsStagedOutput stagedOutput;
+    return stagedOutput;
+}
+
+QString MsvsStagedOutput::stagedFilePath(const QString &filePath)
+{
+    return filePath + QStringLiteral(".qbs-staged");
+}
+
+void MsvsStagedOutput::reset()
+{
+    m_staging = false;
+    m_archivePath.clear();
+    m_archiveRoot.clear();
+    m_filePaths.clear();
+    m_knownFilePaths.clear();
+    m_archiveFiles.clear();
+    m_journal.close();
+}
+
+void MsvsStagedOutput::begin()
+{
+    QMutexLocker locker(&m_mutex);
+    reset();
+    m_staging = true;
+}
+
+void MsvsStagedOutput::beginArchive(const QString &archivePath, const QString &archiveRoot)
+{
+    QMutexLocker locker(&m_mutex);
+    reset();
+    m_staging = true;
+    m_archivePath = archivePath;
+    m_archiveRoot = archiveRoot;
+}
+
+bool MsvsStagedOutput::setJournal(const QString &journalFilePath)
+{
+    QMutexLocker locker(&m_mutex);
+    QBS_CHECK(m_staging && m_archivePath.isEmpty() && m_filePaths.isEmpty());
+    m_journal.setFileName(journalFilePath);
+    return m_journal.open(QIODevice::WriteOnly | QIODevice::Truncate);
+}
+
+bool MsvsStagedOutput::adoptJournal(const QString &journalFilePath)
+{
+    QFile journal(journalFilePath);
+    if (!journal.open(QIODevice::ReadOnly))
+        return false;
+    const QList<QByteArray> lines = journal.readAll().split('\n');
+    journal.close();
+
+    QMutexLocker locker(&m_mutex);
+    QBS_CHECK(m_staging && m_archivePath.isEmpty());
+    for (const QByteArray &line : lines) {
+        const QString filePath = QString::fromUtf8(line);
+        if (filePath.isEmpty() || m_knownFilePaths.contains(filePath))
+            continue;
+        m_knownFilePaths.insert(filePath);
+        m_filePaths << filePath;
+    }
+    return journal.remove();
+}
+
+bool MsvsStagedOutput::writeFile(const QString &filePath, const QByteArray &contents)
+{
+    std::vector<QByteArray> parts(1, contents);
+    return writeFile(filePath, parts);
+}
+
+bool MsvsStagedOutput::writeFile(const QString &filePath, std::vector<QByteArray> &parts)
+{
+    MsvsStatistics &statistics = MsvsStatistics::instance();
+    QElapsedTimer timer;
+    if (statistics.isEnabled())
+        timer.start();
+
+    QString targetPath = filePath;
+    {
+        QMutexLocker locker(&m_mutex);
+        // Archive entries are recorded as written when the archive is committed.
+        if (!m_archivePath.isEmpty()) {
+            QByteArray contents;
+            if (parts.size() == 1) {
+                contents = parts.front();
+            } else {
+                qint64 size = 0;
+                for (const QByteArray &part : parts)
+                    size += part.size();
+                contents.reserve(int(size));
+                for (QByteArray &part : parts) {
+                    contents += part;
+                    part.clear();
+                }
+            }
+            m_archiveFiles.insert(filePath, contents);
+            return true;
+        }
+        if (m_staging) {
+            if (!m_knownFilePaths.contains(filePath)) {
+                if (m_journal.isOpen()
+                        && (m_journal.write(filePath.toUtf8().append('\n')) < 0 || !m_journal.flush())) {
+                    return false;
+                }
+                m_knownFilePaths.insert(filePath);
+                m_filePaths << filePath;
+            }
+            targetPath = stagedFilePath(filePath);
+        }
+    }
+
+    QFile file(targetPath);
+    if (!file.open(QIODevice::WriteOnly))
+        return false;
+    qint64 size = 0;
+    for (QByteArray &part : parts) {
+        if (file.write(part) != part.size())
+            return false;
+        size += part.size();
+        part.clear();
+    }
+    if (!file.flush())
+        return false;
+    statistics.recordWrite(size, timer.isValid() ? timer.nsecsElapsed() : 0);
+    return true;
+}
+
+bool MsvsStagedOutput::readFile(const QString &filePath, QByteArray *contents)
+{
+    QString sourcePath = filePath;
+    {
+        QMutexLocker locker(&m_mutex);
+        if (!m_archivePath.isEmpty()) {
+            const auto it = m_archiveFiles.constFind(filePath);
+            if (it == m_archiveFiles.constEnd())
+                return false;
+            *contents = it.value();
+            return true;
+        }
+        if (m_staging && m_knownFilePaths.contains(filePath))
+            sourcePath = stagedFilePath(filePath);
+    }
+
+    QFile file(sourcePath);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+    *contents = file.readAll();
+    return true;
+}
+
+bool MsvsStagedOutput::commit(QString *failedFilePath)
+{
+    QMutexLocker locker(&m_mutex);
+    const bool ok = m_archivePath.isEmpty() ? commitFiles(failedFilePath) : commitArchive(failedFilePath);
+    reset();
+    return ok;
+}
+
+QString MsvsStagedOutput::backupFilePath(const QString &filePath)
+{
+    return filePath + QStringLiteral(".qbs-old");
+}
+
+// Whether the staged file has the same contents as the file it would replace.
+static bool hasSameContents(const QString &stagedPath, const QString &filePath)
+{
+    QFile stagedFile(stagedPath);
+    QFile file(filePath);
+    if (stagedFile.size() != file.size()
+            || !stagedFile.open(QIODevice::ReadOnly) || !file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    static const qint64 kBlockSize = 64 * 1024;
+    while (!stagedFile.atEnd()) {
+        if (stagedFile.read(kBlockSize) != file.read(kBlockSize))
+            return false;
+    }
+    return true;
+}
+
+// Files are moved in the order they were staged, so time stamps keep their order.
+// Unchanged files are left alone, which keeps their time stamps. The replaced files are kept as backups until all files are in place. If one cannot be
+// replaced, e.g. a project file locked by Visual Studio, the backups are moved back.
+bool MsvsStagedOutput::commitFiles(QString *failedFilePath)
+{
+    struct CommittedFile
+    {
+        QString filePath;
+        bool hasBackup;
+    };
+    QList<CommittedFile> committedFiles;
+
+    // Restores the committed files from their backups, and drops the files not yet committed.
+    const auto rollBack = [&](int failedIndex) {
+        if (failedFilePath)
+            *failedFilePath = m_filePaths.at(failedIndex);
+        for (int j = committedFiles.size() - 1; j >= 0; --j) {
+            const CommittedFile &committedFile = committedFiles.at(j);
+            QFile::remove(committedFile.filePath);
+            if (committedFile.hasBackup)
+                QFile::rename(backupFilePath(committedFile.filePath), committedFile.filePath);
+        }
+        for (int j = failedIndex; j < m_filePaths.size(); ++j)
+            QFile::remove(stagedFilePath(m_filePaths.at(j)));
+    };
+
+    for (int i = 0; i < m_filePaths.size(); ++i) {
+        const QString &filePath = m_filePaths.at(i);
+        const QString stagedPath = stagedFilePath(filePath);
+        if (!QFile::exists(stagedPath))
+            continue;
+        if (hasSameContents(stagedPath, filePath)) {
+            QFile::remove(stagedPath);
+            MsvsStatistics::instance().recordSkippedUnchanged();
+            continue;
+        }
+        const QString backupPath = backupFilePath(filePath);
+        QFile::remove(backupPath);
+        const bool hasBackup = QFile::exists(filePath);
+        if (hasBackup && !QFile::rename(filePath, backupPath)) {
+            rollBack(i);
+            return false;
+        }
+        if (!QFile::rename(stagedPath, filePath)) {
+            if (hasBackup)
+                QFile::rename(backupPath, filePath);
+            rollBack(i);
+            return false;
+        }
+        committedFiles << CommittedFile{filePath, hasBackup};
+    }
+
+    for (const CommittedFile &committedFile : committedFiles)
+        if (committedFile.hasBackup)
+            QFile::remove(backupFilePath(committedFile.filePath));
+    return true;
+}
+
+bool MsvsStagedOutput::commitArchive(QString *failedFilePath)
+{
+    if (m_archivePath == QStringLiteral("-")) {
+        QFile standardOutput;
+        return standardOutput.open(stdout, QIODevice::WriteOnly)
+                && writeArchive(standardOutput, failedFilePath) && standardOutput.flush();
+    }
+
+    QSaveFile archive(m_archivePath);
+    if (!archive.open(QIODevice::WriteOnly) || !writeArchive(archive, failedFilePath) || !archive.commit()) {
+        if (failedFilePath && failedFilePath->isEmpty())
+            *failedFilePath = m_archivePath;
+        return false;
+    }
+    return true;
+}
+
+static void setOctalField(char *field, int size, qint64 value)
+{
+    // The last byte of a numeric field terminates it.
+    const QByteArray digits = QByteArray::number(value, 8).rightJustified(size - 1, '0');
+    memcpy(field, digits.constData(), size_t(size - 1));
+}
+
+// Splits an entry name into the ustar name and prefix fields at a directory separator.
+static bool setTarName(char *header, const QByteArray &name)
+{
+    if (name.size() <= 100) {
+        memcpy(header, name.constData(), size_t(name.size()));
+        return true;
+    }
+    for (int i = name.size() - 101; i < name.size(); ++i) {
+        if (i < 0 || name.at(i) != '/' || i > 155)
+            continue;
+        memcpy(header + 345, name.constData(), size_t(i));
+        memcpy(header, name.constData() + i + 1, size_t(name.size() - i - 1));
+        return true;
+    }
+    return false;
+}
+
+bool MsvsStagedOutput::writeArchive(QIODevice &device, QString *failedFilePath) const
+{
+    static const char zeroBlock[512] = {};
+    MsvsStatistics &statistics = MsvsStatistics::instance();
+    const QDir root(m_archiveRoot);
+    const qint64 modificationTime = QDateTime::currentDateTimeUtc().toMSecsSinceEpoch() / 1000;
+
+    for (auto it = m_archiveFiles.cbegin(); it != m_archiveFiles.cend(); ++it) {
+        QElapsedTimer timer;
+        if (statistics.isEnabled())
+            timer.start();
+        const QString entryName = QDir::fromNativeSeparators(root.relativeFilePath(it.key()));
+        char header[512] = {};
+        if (entryName.startsWith(QStringLiteral("../")) || !setTarName(header, entryName.toUtf8())) {
+            if (failedFilePath)
+                *failedFilePath = it.key();
+            return false;
+        }
+        setOctalField(header + 100, 8, 0644);
+        setOctalField(header + 108, 8, 0);
+        setOctalField(header + 116, 8, 0);
+        setOctalField(header + 124, 12, it.value().size());
+        setOctalField(header + 136, 12, modificationTime);
+        header[156] = '0';
+        memcpy(header + 257, "ustar", 6);
+        memcpy(header + 263, "00", 2);
+
+        // The checksum is computed with its own field filled with blanks.
+        memset(header + 148, ' ', 8);
+        uint checksum = 0;
+        for (const char c : header)
+            checksum += uchar(c);
+        setOctalField(header + 148, 7, checksum);
+        header[154] = '\0';
+
+        const qint64 padding = (512 - it.value().size() % 512) % 512;
+        if (device.write(header, sizeof header) != qint64(sizeof header)
+                || device.write(it.value()) != it.value().size()
+                || device.write(zeroBlock, padding) != padding) {
+            return false;
+        }
+        statistics.recordWrite(it.value().size(), timer.isValid() ? timer.nsecsElapsed() : 0);
+    }
+    return device.write(zeroBlock, sizeof zeroBlock) == qint64(sizeof zeroBlock)
+            && device.write(zeroBlock, sizeof zeroBlock) == qint64(sizeof zeroBlock);
+}
+
+void MsvsStagedOutput::discard()
+{
+    QMutexLocker locker(&m_mutex);
+    for (const QString &filePath : m_filePaths)
+        QFile::remove(stagedFilePath(filePath));
+    reset();
+}
+
+void MsvsStagedOutput::handOver()
+{
+    QMutexLocker locker(&m_mutex);
+    reset();
+}
+
+} // namespace qbs
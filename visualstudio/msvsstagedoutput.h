@@ -0,0 +1,111 @@
+/****************************************************************************
+**
+** Copyright (C) 2015 The Qt Company Ltd.
+** Contact: http://www.qt.io/licensing
+**
+** This file is part of the Qt Build Suite.
+**
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms and
+** conditions see http://www.qt.io/terms-conditions. For further information
+** use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file.  Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, The Qt Company gives you certain additional
+** rights.  These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+****************************************************************************/
+
+
+#ifndef QBS_MSVSSTAGEDOUTPUT_H
+#define QBS_MSVSSTAGEDOUTPUT_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QMap>
+#include <QMutex>
+#include <QSet>
+#include <QStringList>
+
+#include <vector>
+
+QT_BEGIN_NAMESPACE
+class QIODevice;
+QT_END_NAMESPACE
+
+namespace qbs {
+
+/*!
+ * \brief The MsvsStagedOutput class receives all generated files and defers their publication
+ * until a generation completed. By default, each file is written to a temporary file next to
+ * it, which commit() moves into place. In archive mode the files are kept in memory, and
+ * commit() streams them into one tar archive, or to the standard output, without creating
+ * any of them on disk. A failed or canceled generation discards everything and leaves the
+ * outputs of the previous run intact. Files staged on disk by another process are committed
+ * or discarded together with the own ones after adopting the journal listing them.
+ */
+class MsvsStagedOutput
+{
+public:
+    static MsvsStagedOutput &instance();
+
+    // Stages files on disk.
+    void begin();
+    // Stages files for the archive at archivePath ("-" for the standard output),
+    // with entry names relative to archiveRoot.
+    void beginArchive(const QString &archivePath, const QString &archiveRoot);
+    bool isArchive() const { return !m_archivePath.isEmpty(); }
+    // Lists each file staged on disk in the journal at journalFilePath before creating it,
+    // so that the files can be taken over even if this process gets killed.
+    bool setJournal(const QString &journalFilePath);
+    // Takes over the files listed in the journal of another process, and removes the journal.
+    bool adoptJournal(const QString &journalFilePath);
+
+    bool writeFile(const QString &filePath, const QByteArray &contents);
+    // Writes the parts in order, releasing each once written, so that a large file
+    // is not held a second time in one piece.
+    bool writeFile(const QString &filePath, std::vector<QByteArray> &parts);
+    // Reads back a file written by this generation.
+    bool readFile(const QString &filePath, QByteArray *contents);
+
+    bool commit(QString *failedFilePath);
+    void discard();
+    // Leaves the staged files to the process adopting the journal.
+    void handOver();
+
+private:
+    MsvsStagedOutput() = default;
+    static QString stagedFilePath(const QString &filePath);
+    static QString backupFilePath(const QString &filePath);
+    void reset();
+    bool commitFiles(QString *failedFilePath);
+    bool commitArchive(QString *failedFilePath);
+    bool writeArchive(QIODevice &device, QString *failedFilePath) const;
+
+    QMutex m_mutex;
+    bool m_staging = false;
+    QString m_archivePath;
+    QString m_archiveRoot;
+    // Files staged on disk, in the order they were written.
+    QStringList m_filePaths;
+    QSet<QString> m_knownFilePaths;
+    QFile m_journal;
+    // Files staged for the archive, sorted by path.
+    QMap<QString, QByteArray> m_archiveFiles;
+};
+
+} // namespace qbs
+
+#endif // QBS_MSVSSTAGEDOUTPUT_H
@@ -0,0 +1,225 @@
+/****************************************************************************
+**
+** Copyright (C) 2015 The Qt Company Ltd.
+** Contact: http://www.qt.io/licensing
+**
+** This file is part of the Qt Build Suite.
+**
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms and
+** conditions see http://www.qt.io/terms-conditions. For further information
+** use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file.  Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, The Qt Company gives you certain additional
+** rights.  These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+****************************************************************************/
+
+
+#include "msvsstatistics.h"
+
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutexLocker>
+
+#include <algorithm>
+
+namespace qbs {
+
+static double milliseconds(qint64 nanoseconds)
+{
+    return nanoseconds / 1000000.0;
+}
+
+MsvsStatistics &MsvsStatistics::instance()
+{
+    static MsvsStatistics statistics;
+    return statistics;
+}
+
+void MsvsStatistics::setEnabled(bool enabled)
+{
+    QMutexLocker locker(&m_mutex);
+    m_enabled = enabled;
+    m_totalTimer.start();
+    m_currentPhase = Phase();
+    m_phases.clear();
+    m_products = m_selectedProducts = m_configurations = 0;
+    m_renderedProducts = m_restoredProducts = 0;
+    m_sourceFiles = m_renderedBytes = m_writtenFiles = m_writtenBytes = 0;
+    m_restoredFiles = m_restoredBytes = m_unchangedFiles = 0;
+    m_slowestProducts.clear();
+}
+
+void MsvsStatistics::beginPhase(const QString &name)
+{
+    if (!m_enabled)
+        return;
+    QMutexLocker locker(&m_mutex);
+    m_currentPhase = Phase();
+    m_currentPhase.name = name;
+    m_phaseTimer.start();
+}
+
+void MsvsStatistics::endPhase()
+{
+    if (!m_enabled)
+        return;
+    QMutexLocker locker(&m_mutex);
+    m_currentPhase.wallNanoseconds = m_phaseTimer.nsecsElapsed();
+    m_phases << m_currentPhase;
+    m_currentPhase = Phase();
+}
+
+void MsvsStatistics::setProductCounts(int products, int selectedProducts, int configurations)
+{
+    if (!m_enabled)
+        return;
+    QMutexLocker locker(&m_mutex);
+    m_products = products;
+    m_selectedProducts = selectedProducts;
+    m_configurations = configurations;
+}
+
+void MsvsStatistics::recordProduct(const QString &name, qint64 elapsedNanoseconds,
+                                   int sourceFiles, bool restoredFromCache)
+{
+    if (!m_enabled)
+        return;
+    QMutexLocker locker(&m_mutex);
+    m_currentPhase.productNanoseconds += elapsedNanoseconds;
+    m_sourceFiles += sourceFiles;
+    ++(restoredFromCache ? m_restoredProducts : m_renderedProducts);
+
+    if (m_slowestProducts.size() == kSlowestProductCount
+            && m_slowestProducts.last().elapsedNanoseconds >= elapsedNanoseconds) {
+        return;
+    }
+    Product product;
+    product.name = name;
+    product.elapsedNanoseconds = elapsedNanoseconds;
+    product.restoredFromCache = restoredFromCache;
+    const auto it = std::upper_bound(m_slowestProducts.begin(), m_slowestProducts.end(), product,
+                                     [](const Product &left, const Product &right) {
+        return left.elapsedNanoseconds > right.elapsedNanoseconds;
+    });
+    m_slowestProducts.insert(it, product);
+    if (m_slowestProducts.size() > kSlowestProductCount)
+        m_slowestProducts.removeLast();
+}
+
+void MsvsStatistics::recordRendered(qint64 bytes)
+{
+    if (!m_enabled)
+        return;
+    QMutexLocker locker(&m_mutex);
+    m_renderedBytes += bytes;
+}
+
+void MsvsStatistics::recordWrite(qint64 bytes, qint64 elapsedNanoseconds)
+{
+    if (!m_enabled)
+        return;
+    QMutexLocker locker(&m_mutex);
+    ++m_writtenFiles;
+    m_writtenBytes += bytes;
+    m_currentPhase.writeNanoseconds += elapsedNanoseconds;
+}
+
+void MsvsStatistics::recordCacheRestore(int files, qint64 bytes)
+{
+    if (!m_enabled)
+        return;
+    QMutexLocker locker(&m_mutex);
+    m_restoredFiles += files;
+    m_restoredBytes += bytes;
+}
+
+void MsvsStatistics::recordSkippedUnchanged()
+{
+    if (!m_enabled)
+        return;
+    QMutexLocker locker(&m_mutex);
+    ++m_unchangedFiles;
+}
+
+QJsonObject MsvsStatistics::toJson() const
+{
+    QMutexLocker locker(&m_mutex);
+
+    QJsonObject products;
+    products.insert(QStringLiteral("total"), m_products);
+    products.insert(QStringLiteral("selected"), m_selectedProducts);
+    products.insert(QStringLiteral("rendered"), m_renderedProducts);
+    products.insert(QStringLiteral("restoredFromCache"), m_restoredProducts);
+
+    QJsonObject files;
+    files.insert(QStringLiteral("sourceFiles"), m_sourceFiles);
+    files.insert(QStringLiteral("written"), m_writtenFiles);
+    files.insert(QStringLiteral("restoredFromCache"), m_restoredFiles);
+    files.insert(QStringLiteral("skippedUnchanged"), m_unchangedFiles);
+
+    QJsonObject bytes;
+    bytes.insert(QStringLiteral("rendered"), m_renderedBytes);
+    bytes.insert(QStringLiteral("written"), m_writtenBytes);
+    bytes.insert(QStringLiteral("restoredFromCache"), m_restoredBytes);
+
+    QJsonArray phases;
+    for (const Phase &phase : m_phases) {
+        QJsonObject object;
+        object.insert(QStringLiteral("name"), phase.name);
+        object.insert(QStringLiteral("wallMs"), milliseconds(phase.wallNanoseconds));
+        if (phase.productNanoseconds > 0) {
+            object.insert(QStringLiteral("renderMs"),
+                          milliseconds(qMax<qint64>(0, phase.productNanoseconds - phase.writeNanoseconds)));
+        }
+        if (phase.writeNanoseconds > 0)
+            object.insert(QStringLiteral("writeMs"), milliseconds(phase.writeNanoseconds));
+        phases << object;
+    }
+
+    QJsonArray slowestProducts;
+    for (const Product &product : m_slowestProducts) {
+        QJsonObject object;
+        object.insert(QStringLiteral("name"), product.name);
+        object.insert(QStringLiteral("ms"), milliseconds(product.elapsedNanoseconds));
+        object.insert(QStringLiteral("restoredFromCache"), product.restoredFromCache);
+        slowestProducts << object;
+    }
+
+    QJsonObject result;
+    result.insert(QStringLiteral("totalMs"), milliseconds(m_totalTimer.nsecsElapsed()));
+    result.insert(QStringLiteral("configurations"), m_configurations);
+    result.insert(QStringLiteral("products"), products);
+    result.insert(QStringLiteral("files"), files);
+    result.insert(QStringLiteral("bytes"), bytes);
+    result.insert(QStringLiteral("phases"), phases);
+    result.insert(QStringLiteral("slowestProducts"), slowestProducts);
+    return result;
+}
+
+bool MsvsStatistics::writeJson(const QString &filePath) const
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly))
+        return false;
+    file.write(QJsonDocument(toJson()).toJson());
+    return file.flush();
+}
+
+} // namespace qbs
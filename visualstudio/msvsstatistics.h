@@ -0,0 +1,120 @@
+/****************************************************************************
+**
+** Copyright (C) 2015 The Qt Company Ltd.
+** Contact: http://www.qt.io/licensing
+**
+** This file is part of the Qt Build Suite.
+**
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms and
+** conditions see http://www.qt.io/terms-conditions. For further information
+** use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file.  Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, The Qt Company gives you certain additional
+** rights.  These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+****************************************************************************/
+
+
+#ifndef QBS_MSVSSTATISTICS_H
+#define QBS_MSVSSTATISTICS_H
+
+#include <QElapsedTimer>
+#include <QList>
+#include <QMutex>
+#include <QString>
+
+QT_BEGIN_NAMESPACE
+class QJsonObject;
+QT_END_NAMESPACE
+
+namespace qbs {
+
+/*!
+ * \brief The MsvsStatistics class collects the opt-in summary of a generation run for
+ * dashboards: counts, rendered and written bytes, the time of each phase and the slowest
+ * products. Wall-clock times are measured per phase. Render and write times are summed
+ * over the worker threads, so they can exceed the wall-clock time of their phase. Files
+ * restored from the project cache are staged like rendered ones, so they count as written
+ * too. Staged files identical to the existing output are not moved into place, and are
+ * counted as skipped.
+ */
+class MsvsStatistics
+{
+public:
+    static MsvsStatistics &instance();
+
+    bool isEnabled() const { return m_enabled; }
+    void setEnabled(bool enabled);
+
+    void beginPhase(const QString &name);
+    void endPhase();
+
+    void setProductCounts(int products, int selectedProducts, int configurations);
+    void recordProduct(const QString &name, qint64 elapsedNanoseconds, int sourceFiles, bool restoredFromCache);
+    void recordRendered(qint64 bytes);
+    void recordWrite(qint64 bytes, qint64 elapsedNanoseconds);
+    void recordCacheRestore(int files, qint64 bytes);
+    void recordSkippedUnchanged();
+
+    QJsonObject toJson() const;
+    bool writeJson(const QString &filePath) const;
+
+private:
+    MsvsStatistics() = default;
+
+    struct Phase
+    {
+        QString name;
+        qint64 wallNanoseconds = 0;
+        qint64 productNanoseconds = 0;
+        qint64 writeNanoseconds = 0;
+    };
+
+    struct Product
+    {
+        QString name;
+        qint64 elapsedNanoseconds = 0;
+        bool restoredFromCache = false;
+    };
+
+    static const int kSlowestProductCount = 10;
+
+    bool m_enabled = false;
+    mutable QMutex m_mutex;
+    QElapsedTimer m_totalTimer;
+    QElapsedTimer m_phaseTimer;
+    Phase m_currentPhase;
+    QList<Phase> m_phases;
+    int m_products = 0;
+    int m_selectedProducts = 0;
+    int m_configurations = 0;
+    int m_renderedProducts = 0;
+    int m_restoredProducts = 0;
+    qint64 m_sourceFiles = 0;
+    qint64 m_renderedBytes = 0;
+    qint64 m_writtenFiles = 0;
+    qint64 m_writtenBytes = 0;
+    qint64 m_restoredFiles = 0;
+    qint64 m_unchangedFiles = 0;
+    qint64 m_restoredBytes = 0;
+    // Sorted by descending time.
+    QList<Product> m_slowestProducts;
+};
+
+} // namespace qbs
+
+#endif // QBS_MSVSSTATISTICS_H
@@ -0,0 +1,182 @@
+/****************************************************************************
+**
+** Copyright (C) 2015 The Qt Company Ltd.
+** Contact: http://www.qt.io/licensing
+**
+** This file is part of the Qt Build Suite.
+**
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms and
+** conditions see http://www.qt.io/terms-conditions. For further information
+** use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file.  Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, The Qt Company gives you certain additional
+** rights.  These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+****************************************************************************/
+
+
+#include "msvstextencoder.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define QBS_MSVS_TEXTENCODER_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace qbs {
+
+enum EscapeMode { NoEscaping, EscapeText, EscapeAttribute };
+
+// Returns the number of leading characters which are printable ASCII and need no escaping.
+static int plainAsciiPrefixLength(const ushort *data, int size, EscapeMode mode)
+{
+    int i = 0;
+#ifdef QBS_MSVS_TEXTENCODER_SSE2
+    const __m128i lowerBound = _mm_set1_epi16(0x1f);
+    const __m128i upperBound = _mm_set1_epi16(0x7f);
+    const __m128i lessThan = _mm_set1_epi16('<');
+    const __m128i greaterThan = _mm_set1_epi16('>');
+    const __m128i ampersand = _mm_set1_epi16('&');
+    const __m128i quote = _mm_set1_epi16('"');
+    for (; i + 8 <= size; i += 8) {
+        const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+        // Signed comparisons; characters from U+8000 on are negative and fail the lower bound.
+        __m128i plain = _mm_and_si128(_mm_cmpgt_epi16(chunk, lowerBound), _mm_cmplt_epi16(chunk, upperBound));
+        if (mode != NoEscaping) {
+            const __m128i special = _mm_or_si128(
+                        _mm_or_si128(_mm_cmpeq_epi16(chunk, lessThan), _mm_cmpeq_epi16(chunk, greaterThan)),
+                        _mm_or_si128(_mm_cmpeq_epi16(chunk, ampersand), _mm_cmpeq_epi16(chunk, quote)));
+            plain = _mm_andnot_si128(special, plain);
+        }
+        if (_mm_movemask_epi8(plain) != 0xffff)
+            break;
+    }
+#endif
+    for (; i < size; ++i) {
+        const ushort c = data[i];
+        if (c < 0x20 || c >= 0x7f)
+            break;
+        if (mode != NoEscaping && (c == '<' || c == '>' || c == '&' || c == '"'))
+            break;
+    }
+    return i;
+}
+
+static char *copyAscii(char *out, const ushort *data, int size)
+{
+    int i = 0;
+#ifdef QBS_MSVS_TEXTENCODER_SSE2
+    for (; i + 8 <= size; i += 8) {
+        const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+        _mm_storel_epi64(reinterpret_cast<__m128i *>(out + i), _mm_packus_epi16(chunk, chunk));
+    }
+#endif
+    for (; i < size; ++i)
+        out[i] = char(data[i]);
+    return out + size;
+}
+
+static char *appendLatin1(char *out, const char *text)
+{
+    while (*text)
+        *out++ = *text++;
+    return out;
+}
+
+static char *encodeCodePoint(char *out, uint codePoint)
+{
+    if (codePoint < 0x80) {
+        *out++ = char(codePoint);
+    } else if (codePoint < 0x800) {
+        *out++ = char(0xc0 | (codePoint >> 6));
+        *out++ = char(0x80 | (codePoint & 0x3f));
+    } else if (codePoint < 0x10000) {
+        *out++ = char(0xe0 | (codePoint >> 12));
+        *out++ = char(0x80 | ((codePoint >> 6) & 0x3f));
+        *out++ = char(0x80 | (codePoint & 0x3f));
+    } else {
+        *out++ = char(0xf0 | (codePoint >> 18));
+        *out++ = char(0x80 | ((codePoint >> 12) & 0x3f));
+        *out++ = char(0x80 | ((codePoint >> 6) & 0x3f));
+        *out++ = char(0x80 | (codePoint & 0x3f));
+    }
+    return out;
+}
+
+// Encodes one character, or a surrogate pair, and returns the number of characters consumed.
+static int encodeCharacter(char *&out, const ushort *data, int remaining, EscapeMode mode)
+{
+    const ushort c = data[0];
+    if (mode != NoEscaping) {
+        switch (c) {
+        case '<': out = appendLatin1(out, "&lt;"); return 1;
+        case '>': out = appendLatin1(out, "&gt;"); return 1;
+        case '&': out = appendLatin1(out, "&amp;"); return 1;
+        case '"': out = appendLatin1(out, "&quot;"); return 1;
+        case '\t': if (mode == EscapeAttribute) { out = appendLatin1(out, "&#9;"); return 1; } break;
+        case '\n': if (mode == EscapeAttribute) { out = appendLatin1(out, "&#10;"); return 1; } break;
+        case '\r': if (mode == EscapeAttribute) { out = appendLatin1(out, "&#13;"); return 1; } break;
+        default: break;
+        }
+    }
+    if (QChar::isHighSurrogate(c) && remaining > 1 && QChar::isLowSurrogate(data[1])) {
+        out = encodeCodePoint(out, QChar::surrogateToUcs4(c, data[1]));
+        return 2;
+    }
+    out = encodeCodePoint(out, QChar::isSurrogate(c) ? uint(QChar::ReplacementCharacter) : uint(c));
+    return 1;
+}
+
+static void append(QByteArray &out, const QString &text, EscapeMode mode)
+{
+    const ushort *data = text.utf16();
+    const int size = text.size();
+    if (size == 0)
+        return;
+
+    const int offset = out.size();
+    const int prefixLength = plainAsciiPrefixLength(data, size, mode);
+    if (prefixLength == size) {
+        out.resize(offset + size);
+        copyAscii(out.data() + offset, data, size);
+        return;
+    }
+
+    // At most 6 bytes per character ("&quot;"); a surrogate pair takes 4 bytes for 2 characters.
+    out.resize(offset + prefixLength + (size - prefixLength) * 6);
+    char *cursor = copyAscii(out.data() + offset, data, prefixLength);
+    int i = prefixLength;
+    while (i < size) {
+        const int plainLength = plainAsciiPrefixLength(data + i, size - i, mode);
+        cursor = copyAscii(cursor, data + i, plainLength);
+        i += plainLength;
+        if (i < size)
+            i += encodeCharacter(cursor, data + i, size - i, mode);
+    }
+    out.resize(int(cursor - out.constData()));
+}
+
+void MsvsTextEncoder::appendUtf8(QByteArray &out, const QString &text)
+{
+    append(out, text, NoEscaping);
+}
+
+void MsvsTextEncoder::appendEscapedXml(QByteArray &out, const QString &text, bool isAttributeValue)
+{
+    append(out, text, isAttributeValue ? EscapeAttribute : EscapeText);
+}
+
+} // namespace qbs
@@ -0,0 +1,56 @@
+/****************************************************************************
+**
+** Copyright (C) 2015 The Qt Company Ltd.
+** Contact: http://www.qt.io/licensing
+**
+** This file is part of the Qt Build Suite.
+**
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms and
+** conditions see http://www.qt.io/terms-conditions. For further information
+** use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file.  Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, The Qt Company gives you certain additional
+** rights.  These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+****************************************************************************/
+
+
+#ifndef QBS_MSVSTEXTENCODER_H
+#define QBS_MSVSTEXTENCODER_H
+
+#include <QByteArray>
+#include <QString>
+
+namespace qbs {
+
+/*!
+ * \brief The MsvsTextEncoder class transcodes the generated text from UTF-16 to UTF-8.
+ * Nearly all of it is ASCII without XML special characters, which is copied eight
+ * characters at a time with SSE2 where available. Everything else takes the scalar path.
+ * The escaping matches QXmlStreamWriter, so the output does not change.
+ */
+class MsvsTextEncoder
+{
+public:
+    static void appendUtf8(QByteArray &out, const QString &text);
+    // Escapes <, >, & and ", and in attribute values also tabs and line breaks.
+    static void appendEscapedXml(QByteArray &out, const QString &text, bool isAttributeValue);
+};
+
+} // namespace qbs
+
+#endif // QBS_MSVSTEXTENCODER_H
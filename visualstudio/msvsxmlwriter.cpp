@@ -0,0 +1,199 @@
+/****************************************************************************
+**
+** Copyright (C) 2015 The Qt Company Ltd.
+** Contact: http://www.qt.io/licensing
+**
+** This file is part of the Qt Build Suite.
+**
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms and
+** conditions see http://www.qt.io/terms-conditions. For further information
+** use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file.  Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, The Qt Company gives you certain additional
+** rights.  These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+****************************************************************************/
+
+
+#include "msvsxmlwriter.h"
+#include "msvstextencoder.h"
+
+#include <QIODevice>
+
+namespace qbs {
+
+static const int kFlushThreshold = 64 * 1024;
+
+MsvsXmlWriter::MsvsXmlWriter(QIODevice *device)
+    : m_device(device)
+{
+    m_buffer.reserve(kFlushThreshold + kFlushThreshold / 4);
+}
+
+MsvsXmlWriter::MsvsXmlWriter(QByteArray *fragment, const MsvsXmlWriter &parent)
+    : m_device(nullptr)
+    , m_fragment(fragment)
+    , m_tagStack(parent.m_tagStack.size())
+    , m_autoFormatting(parent.m_autoFormatting)
+{
+    m_buffer.reserve(kFlushThreshold + kFlushThreshold / 4);
+}
+
+MsvsXmlWriter::~MsvsXmlWriter()
+{
+    flush();
+}
+
+void MsvsXmlWriter::writeStartDocument()
+{
+    finishStartElement(false);
+    m_buffer.append("<?xml version=\"1.0\" encoding=\"UTF-8\"?>");
+}
+
+void MsvsXmlWriter::writeEndDocument()
+{
+    while (!m_tagStack.isEmpty())
+        writeEndElement();
+    m_buffer.append('\n');
+    flush();
+}
+
+void MsvsXmlWriter::writeStartElement(const QString &name)
+{
+    QByteArray encodedName;
+    MsvsTextEncoder::appendUtf8(encodedName, name);
+    startElement(encodedName);
+}
+
+void MsvsXmlWriter::writeStartElement(MsvsXmlName name)
+{
+    startElement(QByteArray::fromRawData(name.data, name.size));
+}
+
+void MsvsXmlWriter::startElement(const QByteArray &encodedName)
+{
+    if (!finishStartElement(false) && m_autoFormatting)
+        indent(m_tagStack.size());
+    m_tagStack.append(encodedName);
+    m_buffer.append('<');
+    m_buffer.append(encodedName);
+    m_inStartElement = m_lastWasStartElement = true;
+}
+
+void MsvsXmlWriter::writeEndElement()
+{
+    if (m_tagStack.isEmpty())
+        return;
+
+    // Elements without contents are closed as empty tags.
+    if (m_inStartElement) {
+        m_buffer.append("/>");
+        m_lastWasStartElement = m_inStartElement = false;
+        m_tagStack.removeLast();
+    } else {
+        if (!finishStartElement(false) && !m_lastWasStartElement && m_autoFormatting)
+            indent(m_tagStack.size() - 1);
+        m_lastWasStartElement = false;
+        m_buffer.append("</");
+        m_buffer.append(m_tagStack.takeLast());
+        m_buffer.append('>');
+    }
+    if (m_buffer.size() >= kFlushThreshold)
+        flush();
+}
+
+void MsvsXmlWriter::writeAttribute(const QString &name, const QString &value)
+{
+    m_buffer.append(' ');
+    MsvsTextEncoder::appendUtf8(m_buffer, name);
+    m_buffer.append("=\"");
+    MsvsTextEncoder::appendEscapedXml(m_buffer, value, true);
+    m_buffer.append('"');
+}
+
+void MsvsXmlWriter::writeAttribute(MsvsXmlName name, const QString &value)
+{
+    m_buffer.append(' ');
+    m_buffer.append(name.data, name.size);
+    m_buffer.append("=\"");
+    MsvsTextEncoder::appendEscapedXml(m_buffer, value, true);
+    m_buffer.append('"');
+}
+
+void MsvsXmlWriter::writeCharacters(const QString &text)
+{
+    finishStartElement(true);
+    MsvsTextEncoder::appendEscapedXml(m_buffer, text, false);
+}
+
+void MsvsXmlWriter::writeTextElement(const QString &name, const QString &text)
+{
+    writeStartElement(name);
+    writeCharacters(text);
+    writeEndElement();
+}
+
+void MsvsXmlWriter::writeTextElement(MsvsXmlName name, const QString &text)
+{
+    writeStartElement(name);
+    writeCharacters(text);
+    writeEndElement();
+}
+
+// The fragment starts like the first child element would, so the result is the same as
+// if its elements were written here.
+void MsvsXmlWriter::writeFragment(const QByteArray &fragment)
+{
+    if (fragment.isEmpty())
+        return;
+    finishStartElement(false);
+    m_lastWasStartElement = false;
+    m_buffer.append(fragment);
+    if (m_buffer.size() >= kFlushThreshold)
+        flush();
+}
+
+bool MsvsXmlWriter::finishStartElement(bool contents)
+{
+    const bool hadSomethingWritten = m_wroteSomething;
+    m_wroteSomething = contents;
+    if (m_inStartElement) {
+        m_buffer.append('>');
+        m_inStartElement = false;
+    }
+    return hadSomethingWritten;
+}
+
+void MsvsXmlWriter::indent(int level)
+{
+    m_buffer.append('\n');
+    for (int i = 0; i < level; ++i)
+        m_buffer.append("    ");
+}
+
+void MsvsXmlWriter::flush()
+{
+    if (m_buffer.isEmpty() || m_hasError)
+        return;
+    if (m_fragment)
+        m_fragment->append(m_buffer);
+    else if (!m_device || m_device->write(m_buffer) != m_buffer.size())
+        m_hasError = true;
+    m_buffer.resize(0);
+}
+
+} // namespace qbs
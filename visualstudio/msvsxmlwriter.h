@@ -0,0 +1,110 @@
+/****************************************************************************
+**
+** Copyright (C) 2015 The Qt Company Ltd.
+** Contact: http://www.qt.io/licensing
+**
+** This file is part of the Qt Build Suite.
+**
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms and
+** conditions see http://www.qt.io/terms-conditions. For further information
+** use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file.  Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, The Qt Company gives you certain additional
+** rights.  These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+****************************************************************************/
+
+
+#ifndef QBS_MSVSXMLWRITER_H
+#define QBS_MSVSXMLWRITER_H
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+
+QT_BEGIN_NAMESPACE
+class QIODevice;
+QT_END_NAMESPACE
+
+namespace qbs {
+
+// An element or attribute name known at compile time. It is ASCII and written without encoding.
+struct MsvsXmlName
+{
+    template <int N>
+    explicit constexpr MsvsXmlName(const char (&name)[N]) : data(name), size(N - 1) {}
+
+    const char *data;
+    int size;
+};
+
+/*!
+ * \brief The MsvsXmlWriter class writes the generated XML files in UTF-8.
+ * It implements the subset of the QXmlStreamWriter interface the project writers use,
+ * with identical output, but encodes through MsvsTextEncoder and hands the output to the
+ * device in large blocks instead of per token.
+ */
+class MsvsXmlWriter
+{
+public:
+    explicit MsvsXmlWriter(QIODevice *device);
+    // Renders sibling elements at the current position of parent into fragment, to be
+    // spliced in with parent.writeFragment(). The elements must not be left open.
+    MsvsXmlWriter(QByteArray *fragment, const MsvsXmlWriter &parent);
+    ~MsvsXmlWriter();
+
+    void setAutoFormatting(bool autoFormatting) { m_autoFormatting = autoFormatting; }
+
+    void writeStartDocument();
+    void writeEndDocument();
+    void writeStartElement(const QString &name);
+    void writeStartElement(MsvsXmlName name);
+    void writeEndElement();
+    void writeAttribute(const QString &name, const QString &value);
+    void writeAttribute(MsvsXmlName name, const QString &value);
+    void writeCharacters(const QString &text);
+    void writeTextElement(const QString &name, const QString &text);
+    void writeTextElement(MsvsXmlName name, const QString &text);
+    // Appends elements rendered by a fragment writer of this writer.
+    void writeFragment(const QByteArray &fragment);
+
+    bool hasError() const { return m_hasError; }
+
+private:
+    Q_DISABLE_COPY(MsvsXmlWriter)
+
+    // Closes a pending start tag; returns whether characters were written before.
+    bool finishStartElement(bool contents);
+    void startElement(const QByteArray &encodedName);
+    void indent(int level);
+    void flush();
+
+    QIODevice *m_device;
+    QByteArray *m_fragment = nullptr;
+    QByteArray m_buffer;
+    // The encoded names of the open elements; names of MsvsXmlName refer to static data.
+    QVector<QByteArray> m_tagStack;
+    bool m_autoFormatting = false;
+    bool m_inStartElement = false;
+    bool m_lastWasStartElement = false;
+    bool m_wroteSomething = false;
+    bool m_hasError = false;
+};
+
+} // namespace qbs
+
+#endif // QBS_MSVSXMLWRITER_H
@@ -30,10 +30,38 @@
 
 #include "vcbuildprojectwriter.h"
 #include <tools/hostosinfo.h>
-#include <QXmlStreamWriter>
 
 namespace qbs {
 
+// Element and attribute names of the VCBuild format.
+namespace VCBuildSchema {
+constexpr MsvsXmlName BuildCommandLine("BuildCommandLine");
+constexpr MsvsXmlName CleanCommandLine("CleanCommandLine");
+constexpr MsvsXmlName Configuration("Configuration");
+constexpr MsvsXmlName ConfigurationType("ConfigurationType");
+constexpr MsvsXmlName Configurations("Configurations");
+constexpr MsvsXmlName ExcludedFromBuild("ExcludedFromBuild");
+constexpr MsvsXmlName File("File");
+constexpr MsvsXmlName FileConfiguration("FileConfiguration");
+constexpr MsvsXmlName Files("Files");
+constexpr MsvsXmlName Filter("Filter");
+constexpr MsvsXmlName ForcedIncludes("ForcedIncludes");
+constexpr MsvsXmlName IncludeSearchPath("IncludeSearchPath");
+constexpr MsvsXmlName Name("Name");
+constexpr MsvsXmlName Output("Output");
+constexpr MsvsXmlName OutputDirectory("OutputDirectory");
+constexpr MsvsXmlName Platform("Platform");
+constexpr MsvsXmlName Platforms("Platforms");
+constexpr MsvsXmlName PreprocessorDefinitions("PreprocessorDefinitions");
+constexpr MsvsXmlName ProjectGUID("ProjectGUID");
+constexpr MsvsXmlName ProjectType("ProjectType");
+constexpr MsvsXmlName ReBuildCommandLine("ReBuildCommandLine");
+constexpr MsvsXmlName RelativePath("RelativePath");
+constexpr MsvsXmlName Tool("Tool");
+constexpr MsvsXmlName Version("Version");
+constexpr MsvsXmlName VisualStudioProject("VisualStudioProject");
+} // namespace VCBuildSchema
+
 static const QString _VcprojNmakeConfig = QStringLiteral("0");
 static const QString _VcprojListsSeparator = QStringLiteral(";");
 
@@ -42,115 +70,123 @@ QString VCBuildProjectWriter::projectFileExtension() const
     return QStringLiteral(".vcproj");
 }
 
-void VCBuildProjectWriter::writeHeader(QXmlStreamWriter &xmlWriter, const MsvsPreparedProduct &product) const
+void VCBuildProjectWriter::writeHeader(MsvsXmlWriter &xmlWriter, const MsvsPreparedProduct &product) const
 {
     xmlWriter.writeStartDocument();
 
-    xmlWriter.writeStartElement(QStringLiteral("VisualStudioProject"));
-    xmlWriter.writeAttribute(QStringLiteral("ProjectType"), QStringLiteral("Visual C++"));
-    xmlWriter.writeAttribute(QStringLiteral("Version"), m_versionInfo.toolsVersion());
-    xmlWriter.writeAttribute(QStringLiteral("Name"), product.name);
-    xmlWriter.writeAttribute(QStringLiteral("ProjectGUID"), product.guid);
+    xmlWriter.writeStartElement(VCBuildSchema::VisualStudioProject);
+    xmlWriter.writeAttribute(VCBuildSchema::ProjectType, QStringLiteral("Visual C++"));
+    xmlWriter.writeAttribute(VCBuildSchema::Version, m_versionInfo.toolsVersion());
+    xmlWriter.writeAttribute(VCBuildSchema::Name, product.name);
+    xmlWriter.writeAttribute(VCBuildSchema::ProjectGUID, product.guid);
 
     // Project begin
-    xmlWriter.writeStartElement(QStringLiteral("Platforms"));
+    xmlWriter.writeStartElement(VCBuildSchema::Platforms);
     foreach (const QString &platformName, product.uniquePlatforms()) {
-        xmlWriter.writeStartElement(QStringLiteral("Platform"));
-        xmlWriter.writeAttribute(QStringLiteral("Name"), platformName);
+        xmlWriter.writeStartElement(VCBuildSchema::Platform);
+        xmlWriter.writeAttribute(VCBuildSchema::Name, platformName);
         xmlWriter.writeEndElement();
     }
     xmlWriter.writeEndElement();
 }
 
-void VCBuildProjectWriter::writeConfigurations(QXmlStreamWriter &xmlWriter,
+void VCBuildProjectWriter::writeConfigurations(MsvsXmlWriter &xmlWriter,
                                                       const MsvsPreparedProduct &product,
-                                                      const QSet<MsvsProjectConfiguration> &allConfigurations) const
+                                                      const QSet<MsvsProjectConfiguration> &allConfigurations,
+                                                      const QString &projectDirectory) const
 {
-    xmlWriter.writeStartElement(QStringLiteral("Configurations"));
-    VisualStudioXmlProjectWriter::writeConfigurations(xmlWriter, product, allConfigurations);
+    xmlWriter.writeStartElement(VCBuildSchema::Configurations);
+    VisualStudioXmlProjectWriter::writeConfigurations(xmlWriter, product, allConfigurations, projectDirectory);
     xmlWriter.writeEndElement();
 }
 
-void VCBuildProjectWriter::writeConfiguration(QXmlStreamWriter &xmlWriter,
+void VCBuildProjectWriter::writeConfiguration(MsvsXmlWriter &xmlWriter,
                                                  const MsvsPreparedProduct &product,
                                                  const MsvsProjectConfiguration &buildTask,
-                                                 const ProductData &productData) const
+                                                 const ProductData &productData,
+                                                 const QString &projectDirectory) const
 {
-    const QString targetDir = product.targetPath;
-    const PropertyMap properties = productData.moduleProperties();
-    const QString executableSuffix = properties.getModuleProperty(QStringLiteral("qbs"), QStringLiteral("executableSuffix")).toString();
-    const QString fullTargetName =  product.targetName + (product.isApplication ? executableSuffix : QString());
+    const MsvsProductProperties &properties = product.propertiesFor(buildTask);
+    const QString targetDir = projectDirectoryPath(properties.targetPath, projectDirectory);
+    const QString &fullTargetName = properties.targetName;
 
-    const QStringList includePaths = QStringList()
-            << properties.getModulePropertiesAsStringList(QStringLiteral("cpp"), QStringLiteral("includePaths"))
-            << properties.getModulePropertiesAsStringList(QStringLiteral("cpp"), QStringLiteral("systemIncludePaths"));
-    const QStringList cppDefines = properties.getModulePropertiesAsStringList(QStringLiteral("cpp"), QStringLiteral("defines"));
+    const QStringList includePaths = projectPaths(properties.allIncludePaths, projectDirectory);
+    const QStringList &cppDefines = properties.defines;
 
     // For VCBuild we set only NMake options,
     // as it ignores VCCompiler options for configuration "Makefile".
-    xmlWriter.writeStartElement(QStringLiteral("Configuration"));
-
-    xmlWriter.writeAttribute(QStringLiteral("Name"), buildTask.fullName());
-    xmlWriter.writeAttribute(QStringLiteral("OutputDirectory"), targetDir);
-    xmlWriter.writeAttribute(QStringLiteral("ConfigurationType"), _VcprojNmakeConfig);
-
-    xmlWriter.writeStartElement(QStringLiteral("Tool"));
-    xmlWriter.writeAttribute(QStringLiteral("Name"), QStringLiteral("VCNMakeTool"));
-    xmlWriter.writeAttribute(QStringLiteral("BuildCommandLine"), qbsCommandLine(QStringLiteral("install"), product, buildTask));
-    xmlWriter.writeAttribute(QStringLiteral("ReBuildCommandLine"), qbsCommandLine(QStringLiteral("install"), product, buildTask));  // using build command.
-    xmlWriter.writeAttribute(QStringLiteral("CleanCommandLine"), qbsCommandLine(QStringLiteral("clean"), product, buildTask));
-    xmlWriter.writeAttribute(QStringLiteral("Output"), QStringLiteral("$(OutDir)%1").arg(fullTargetName));
+    xmlWriter.writeStartElement(VCBuildSchema::Configuration);
+
+    xmlWriter.writeAttribute(VCBuildSchema::Name, buildTask.fullName());
+    xmlWriter.writeAttribute(VCBuildSchema::OutputDirectory, targetDir);
+    xmlWriter.writeAttribute(VCBuildSchema::ConfigurationType, _VcprojNmakeConfig);
+
+    xmlWriter.writeStartElement(VCBuildSchema::Tool);
+    xmlWriter.writeAttribute(VCBuildSchema::Name, QStringLiteral("VCNMakeTool"));
+    xmlWriter.writeAttribute(VCBuildSchema::BuildCommandLine, qbsBuildCommandLine(product, buildTask, projectDirectory));
+    xmlWriter.writeAttribute(VCBuildSchema::ReBuildCommandLine, qbsBuildCommandLine(product, buildTask, projectDirectory));  // using build command.
+    xmlWriter.writeAttribute(VCBuildSchema::CleanCommandLine, qbsCommandLine(QStringLiteral("clean"), product, buildTask, projectDirectory));
+    xmlWriter.writeAttribute(VCBuildSchema::Output, QStringLiteral("$(OutDir)%1").arg(fullTargetName));
     const auto sep = Internal::HostOsInfo::pathListSeparator(Internal::HostOsInfo::HostOsWindows);
-    xmlWriter.writeAttribute(QStringLiteral("PreprocessorDefinitions"), cppDefines.join(sep));
-    xmlWriter.writeAttribute(QStringLiteral("IncludeSearchPath"), includePaths.join(sep));
+    xmlWriter.writeAttribute(VCBuildSchema::PreprocessorDefinitions, cppDefines.join(sep));
+    xmlWriter.writeAttribute(VCBuildSchema::IncludeSearchPath, includePaths.join(sep));
+    if (!properties.forcedIncludes.isEmpty())
+        xmlWriter.writeAttribute(VCBuildSchema::ForcedIncludes, projectPaths(properties.forcedIncludes, projectDirectory).join(sep));
     xmlWriter.writeEndElement();
 
     xmlWriter.writeEndElement();
 }
 
-void VCBuildProjectWriter::writeFiles(QXmlStreamWriter &xmlWriter,
+void VCBuildProjectWriter::writeFiles(MsvsXmlWriter &xmlWriter,
                                              const QSet<MsvsProjectConfiguration> &allConfigurations,
-                                             const VisualStudioXmlProjectWriter::ProjectConfigurations &allProjectFilesConfigurations) const
+                                             const VisualStudioXmlProjectWriter::ProjectConfigurations &allProjectFilesConfigurations,
+                                             const VisualStudioXmlProjectWriter::ProjectFileTags &allProjectFileTags) const
 {
-    xmlWriter.writeStartElement(QStringLiteral("Files"));
+    QHash<MsvsProjectConfiguration, QString> buildTaskNames;
+    for (const MsvsProjectConfiguration &buildTask : allConfigurations)
+        buildTaskNames.insert(buildTask, buildTask.fullName());
+
+    const QVector<ProjectFile> files = projectFiles(allConfigurations, allProjectFilesConfigurations, allProjectFileTags);
+
+    xmlWriter.writeStartElement(VCBuildSchema::Files);
     foreach (const VisualStudioItemGroupFilter &options, m_filterOptions) {
         QList<FilePathWithConfigurations> filterFilesWithDisabledConfigurations;
-        foreach (const QString &filePath, allProjectFilesConfigurations.keys()) {
-            if (options.matchesFilter(filePath)) {
+        for (const ProjectFile &projectFile : files) {
+            if (options.matchesFilter(projectFile.filePath)) {
                 QStringList disabledFileConfigurations;
-                QSet<MsvsProjectConfiguration> disabledConfigurations = allConfigurations - allProjectFilesConfigurations[filePath];
-                foreach (const MsvsProjectConfiguration &buildTask, disabledConfigurations)
-                    disabledFileConfigurations << buildTask.fullName();
+                for (const MsvsProjectConfiguration &buildTask : projectFile.disabledConfigurations)
+                    disabledFileConfigurations << buildTaskNames[buildTask];
 
-                filterFilesWithDisabledConfigurations << FilePathWithConfigurations(filePath, disabledFileConfigurations);
+                filterFilesWithDisabledConfigurations << FilePathWithConfigurations(projectFile.filePath, disabledFileConfigurations);
             }
         }
 
         if (filterFilesWithDisabledConfigurations.isEmpty())
             continue;
 
-        xmlWriter.writeStartElement(QStringLiteral("Filter"));
-        xmlWriter.writeAttribute(QStringLiteral("Name"), options.title);
+        xmlWriter.writeStartElement(VCBuildSchema::Filter);
+        xmlWriter.writeAttribute(VCBuildSchema::Name, options.title);
 
-        foreach (const FilePathWithConfigurations &filePathAndConfig, filterFilesWithDisabledConfigurations) {
-            xmlWriter.writeStartElement(QStringLiteral("File"));
-            xmlWriter.writeAttribute(QStringLiteral("RelativePath"), filePathAndConfig.first); // No error! In VS absolute paths stored such way.
+        writeElements(xmlWriter, filterFilesWithDisabledConfigurations.size(), [&](MsvsXmlWriter &fileWriter, int index) {
+            const FilePathWithConfigurations &filePathAndConfig = filterFilesWithDisabledConfigurations.at(index);
+            fileWriter.writeStartElement(VCBuildSchema::File);
+            fileWriter.writeAttribute(VCBuildSchema::RelativePath, filePathAndConfig.first); // No error! In VS absolute paths stored such way.
 
             foreach (const QString &disabledConfiguration, filePathAndConfig.second) {
-                xmlWriter.writeStartElement(QStringLiteral("FileConfiguration"));
-                xmlWriter.writeAttribute(QStringLiteral("Name"), disabledConfiguration);
-                xmlWriter.writeAttribute(QStringLiteral("ExcludedFromBuild"), QStringLiteral("true"));
-                xmlWriter.writeEndElement();
+                fileWriter.writeStartElement(VCBuildSchema::FileConfiguration);
+                fileWriter.writeAttribute(VCBuildSchema::Name, disabledConfiguration);
+                fileWriter.writeAttribute(VCBuildSchema::ExcludedFromBuild, QStringLiteral("true"));
+                fileWriter.writeEndElement();
             }
 
-            xmlWriter.writeEndElement();
-        }
+            fileWriter.writeEndElement();
+        });
 
         xmlWriter.writeEndElement();
     }
 }
 
-void VCBuildProjectWriter::writeFooter(QXmlStreamWriter &xmlWriter) const
+void VCBuildProjectWriter::writeFooter(MsvsXmlWriter &xmlWriter) const
 {
     xmlWriter.writeEndElement(); // </VisualStudioProject>
     xmlWriter.writeEndDocument();
@@ -44,18 +44,21 @@ public:
     QString projectFileExtension() const override;
 
 protected:
-    void writeHeader(QXmlStreamWriter &xmlWriter, const MsvsPreparedProduct &product) const override;
-    void writeConfigurations(QXmlStreamWriter &xmlWriter,
+    void writeHeader(MsvsXmlWriter &xmlWriter, const MsvsPreparedProduct &product) const override;
+    void writeConfigurations(MsvsXmlWriter &xmlWriter,
                              const MsvsPreparedProduct &product,
-                             const QSet<MsvsProjectConfiguration> &allConfigurations) const override;
-    void writeConfiguration(QXmlStreamWriter &xmlWriter,
+                             const QSet<MsvsProjectConfiguration> &allConfigurations,
+                             const QString &projectDirectory) const override;
+    void writeConfiguration(MsvsXmlWriter &xmlWriter,
                             const MsvsPreparedProduct &product,
                             const MsvsProjectConfiguration &buildTask,
-                            const ProductData &productData) const override;
-    void writeFiles(QXmlStreamWriter &xmlWriter,
+                            const ProductData &productData,
+                            const QString &projectDirectory) const override;
+    void writeFiles(MsvsXmlWriter &xmlWriter,
                     const QSet<MsvsProjectConfiguration> &allConfigurations,
-                    const ProjectConfigurations &allProjectFilesConfigurations) const override;
-    void writeFooter(QXmlStreamWriter &xmlWriter) const override;
+                    const ProjectConfigurations &allProjectFilesConfigurations,
+                    const ProjectFileTags &allProjectFileTags) const override;
+    void writeFooter(MsvsXmlWriter &xmlWriter) const override;
 };
 
 }
@@ -1,22 +1,54 @@
 INCLUDEPATH += $$PWD/..
 
 HEADERS += \
+    $$PWD/msvsbuildtiming.h \
+    $$PWD/msvscompilationdatabasewriter.h \
+    $$PWD/msvsjobpool.h \
+    $$PWD/msvsmemoryaccounting.h \
+    $$PWD/msvsopenfolderwriter.h \
+    $$PWD/msvsparallel.h \
+    $$PWD/msvsprogress.h \
     $$PWD/msvspreparedproject.h \
+    $$PWD/msvsproductproperties.h \
+    $$PWD/msvsprojectcache.h \
+    $$PWD/msvsrenderbuffer.h \
+    $$PWD/msvsshards.h \
+    $$PWD/msvsstagedoutput.h \
+    $$PWD/msvsstatistics.h \
+    $$PWD/msvstextencoder.h \
+    $$PWD/msvsxmlwriter.h \
     $$PWD/msbuildprojectwriter.h \
     $$PWD/vcbuildprojectwriter.h \
     $$PWD/visualstudiosolutionwriter.h \
     $$PWD/visualstudiogenerator.h \
+    $$PWD/visualstudiogeneratoroptions.h \
     $$PWD/visualstudioitemgroupfilter.h \
     $$PWD/visualstudioxmlprojectwriter.h
 
 
 SOURCES += \
+    $$PWD/msvsbuildtiming.cpp \
+    $$PWD/msvscompilationdatabasewriter.cpp \
+    $$PWD/msvsjobpool.cpp \
+    $$PWD/msvsmemoryaccounting.cpp \
+    $$PWD/msvsopenfolderwriter.cpp \
+    $$PWD/msvsparallel.cpp \
+    $$PWD/msvsprogress.cpp \
     $$PWD/msvspreparedproject.cpp \
+    $$PWD/msvsproductproperties.cpp \
+    $$PWD/msvsprojectcache.cpp \
+    $$PWD/msvsrenderbuffer.cpp \
+    $$PWD/msvsshards.cpp \
+    $$PWD/msvsstagedoutput.cpp \
+    $$PWD/msvsstatistics.cpp \
+    $$PWD/msvstextencoder.cpp \
+    $$PWD/msvsxmlwriter.cpp \
     $$PWD/msbuildprojectwriter.cpp \
     $$PWD/vcbuildprojectwriter.cpp \
     $$PWD/visualstudiosolutionwriter.cpp \
     $$PWD/visualstudiogenerator.cpp \
+    $$PWD/visualstudiogeneratoroptions.cpp \
     $$PWD/visualstudioitemgroupfilter.cpp \
     $$PWD/visualstudioxmlprojectwriter.cpp
 
-
+win32: LIBS += -lpsapi
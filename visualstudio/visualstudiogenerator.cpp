@@ -30,6 +30,17 @@
 
 #include "visualstudiogenerator.h"
 #include "msbuildprojectwriter.h"
+#include "msvsbuildtiming.h"
+#include "msvscompilationdatabasewriter.h"
+#include "msvsjobpool.h"
+#include "msvsmemoryaccounting.h"
+#include "msvsopenfolderwriter.h"
+#include "msvsparallel.h"
+#include "msvsprogress.h"
+#include "msvsprojectcache.h"
+#include "msvsshards.h"
+#include "msvsstatistics.h"
+#include "msvsstagedoutput.h"
 #include "vcbuildprojectwriter.h"
 #include "visualstudiosolutionwriter.h"
 
@@ -41,20 +52,59 @@
 #include <QCoreApplication>
 #include <QDebug>
 #include <QDir>
-#include <QFile>
+#include <QElapsedTimer>
 #include <QFileInfo>
 
+#include <algorithm>
+#include <memory>
+
 using namespace qbs;
 using namespace qbs::Internal;
 
+// Prints the start of each phase and then the progress at most once per second.
+static MsvsProgress::Callback printingProgressCallback()
+{
+    const auto lastPhase = std::make_shared<QString>();
+    const auto lastReport = std::make_shared<QElapsedTimer>();
+    return [lastPhase, lastReport](const MsvsProgressInfo &info) {
+        if (info.phase == *lastPhase && info.done < info.total && lastReport->elapsed() < 1000)
+            return;
+        *lastPhase = info.phase;
+        lastReport->start();
+        qDebug().noquote() << QStringLiteral("%1: %2/%3 (%4/s)")
+                              .arg(info.phase).arg(info.done).arg(info.total)
+                              .arg(info.throughput, 0, 'f', 1);
+    };
+}
+
 VisualStudioGenerator::VisualStudioGenerator(const VisualStudioVersionInfo &versionInfo)
-    : m_versionInfo(versionInfo)
+    : m_versionInfos({versionInfo})
 {
+    m_progress.setCallback(printingProgressCallback());
+}
+
+VisualStudioGenerator::VisualStudioGenerator(const QList<VisualStudioVersionInfo> &versionInfos)
+    : m_versionInfos(versionInfos)
+    , m_multiTarget(true)
+{
+    m_progress.setCallback(printingProgressCallback());
+}
+
+void VisualStudioGenerator::setProgressCallback(const MsvsProgress::Callback &callback)
+{
+    m_progress.setCallback(callback);
+}
+
+void VisualStudioGenerator::cancel()
+{
+    m_progress.cancel();
 }
 
 QString VisualStudioGenerator::generatorName() const
 {
-    return QStringLiteral("visualstudio%1").arg(m_versionInfo.marketingVersion());
+    if (m_multiTarget)
+        return QStringLiteral("visualstudio-multi");
+    return QStringLiteral("visualstudio%1").arg(m_versionInfos.first().marketingVersion());
 }
 
 void VisualStudioGenerator::setupGenerator()
@@ -63,9 +113,11 @@ void VisualStudioGenerator::setupGenerator()
     QSet<QString> projectNames;
     QSet<QString> qbsProjectFiles;
     QSet<QString> buildDirectories;
+    QSet<QString> buildSystemFiles;
 
     foreach (const qbs::Project &proj, projects()) {
         profileNames << proj.profile();
+        buildSystemFiles.unite(proj.buildSystemFiles());
         projectNames << proj.projectData().name();
         qbsProjectFiles << proj.projectData().location().filePath();
 
@@ -83,6 +135,8 @@ void VisualStudioGenerator::setupGenerator()
     m_projectName = projectNames.toList().first();
     m_qbsProjectFile = qbsProjectFiles.toList().first();
     m_baseBuildDirectory = buildDirectories.toList().first();
+    m_buildSystemFiles = buildSystemFiles.toList();
+    m_buildSystemFiles.sort();
 
     QBS_CHECK(m_qbsProjectFile.isAbsolute() && m_qbsProjectFile.exists());
     QBS_CHECK(m_baseBuildDirectory.isAbsolute() && m_baseBuildDirectory.exists());
@@ -97,9 +151,241 @@ void VisualStudioGenerator::setupGenerator()
 
 void VisualStudioGenerator::generate(const InstallOptions &installOptions)
 {
+    m_options = VisualStudioGeneratorOptions::fromEnvironment();
+
+    MsvsMemoryAccounting &memoryAccounting = MsvsMemoryAccounting::instance();
+    memoryAccounting.setEnabled(m_options.memoryAccountingEnabled());
+    MsvsStatistics &statistics = MsvsStatistics::instance();
+    statistics.setEnabled(!m_options.statisticsFilePath.isEmpty());
+
+    MsvsStagedOutput &stagedOutput = MsvsStagedOutput::instance();
+    try {
+        generateStaged(installOptions);
+    } catch (...) {
+        stagedOutput.discard();
+        m_progress.resetCancellation();
+        throw;
+    }
+    m_progress.resetCancellation();
+
+    // The coordinator commits the files of all shards at once.
+    QString failedFilePath;
+    bool committed = true;
+    if (m_options.isShardWorker()) {
+        stagedOutput.handOver();
+    } else {
+        statistics.beginPhase(QStringLiteral("commit"));
+        committed = stagedOutput.commit(&failedFilePath);
+        statistics.endPhase();
+    }
+    if (!committed) {
+        if (m_options.outputArchive.isEmpty())
+            throw ErrorInfo(Tr::tr("Failed to replace %1").arg(failedFilePath));
+        throw ErrorInfo(Tr::tr("Failed to write %1 to the archive %2")
+                        .arg(failedFilePath.isEmpty() ? m_options.outputArchive : failedFilePath,
+                             m_options.outputArchive));
+    }
+
+    reportMemoryAccounting();
+    if (statistics.isEnabled() && !statistics.writeJson(reportFilePath(m_options.statisticsFilePath)))
+        qWarning() << "Failed to write statistics to" << reportFilePath(m_options.statisticsFilePath);
+}
+
+// The workers of a sharded generation report next to the report of the coordinator.
+QString VisualStudioGenerator::reportFilePath(const QString &filePath) const
+{
+    if (!m_options.isShardWorker())
+        return filePath;
+    return filePath + QStringLiteral(".shard-%1").arg(m_options.shardIndex);
+}
+
+// Only evaluated with statistics enabled.
+int VisualStudioGenerator::sourceFileCount(const MsvsPreparedProduct &product)
+{
+    if (!MsvsStatistics::instance().isEnabled())
+        return 0;
+    QSet<QString> filePaths;
+    for (const ProductData &productData : product.configurations)
+        for (const GroupData &groupData : productData.groups())
+            if (groupData.isEnabled())
+                for (const ArtifactData &artifact : groupData.allSourceArtifacts())
+                    filePaths.insert(artifact.filePath());
+    return filePaths.size();
+}
+
+void VisualStudioGenerator::generateStaged(const InstallOptions &installOptions)
+{
+    MsvsMemoryAccounting &memoryAccounting = MsvsMemoryAccounting::instance();
+    MsvsStatistics &statistics = MsvsStatistics::instance();
+
+    memoryAccounting.beginPhase(QStringLiteral("setup"));
+    statistics.beginPhase(QStringLiteral("setup"));
     setupGenerator();
+    memoryAccounting.endPhase();
+    statistics.endPhase();
+
+    // The archive entries are relative to the build directory known from the setup.
+    MsvsStagedOutput &stagedOutput = MsvsStagedOutput::instance();
+    if (m_options.outputArchive.isEmpty())
+        stagedOutput.begin();
+    else
+        stagedOutput.beginArchive(m_options.outputArchive, m_baseBuildDirectory.absolutePath());
+
+    static const QStringList buildCommands = {
+        QStringLiteral("install"), QStringLiteral("build"), QStringLiteral("incremental-install")
+    };
+    if (!buildCommands.contains(m_options.buildCommand))
+        throw ErrorInfo(Tr::tr("Unknown build command '%1'").arg(m_options.buildCommand));
+
+    // The Open Folder metadata lives in the source directory, outside the archive root.
+    if (!m_options.outputArchive.isEmpty() && !m_options.openFolderDirectory.isEmpty()) {
+        throw ErrorInfo(Tr::tr("Open Folder metadata cannot be written to an output archive; "
+                               "unset QBS_MSVS_OPEN_FOLDER or QBS_MSVS_OUTPUT_ARCHIVE"));
+    }
+    // The workers stage their files on disk, and the Open Folder metadata and the
+    // compilation database need all products.
+    if (m_options.shardCount > 1 && (!m_options.outputArchive.isEmpty() || !m_options.openFolderDirectory.isEmpty()
+                                     || !m_options.compileCommandsConfiguration.isEmpty())) {
+        throw ErrorInfo(Tr::tr("Sharded generation supports neither output archives, "
+                               "Open Folder metadata nor compilation databases"));
+    }
+    if (m_options.isShardWorker()) {
+        const QString journalFilePath = MsvsShards::journalFilePath(m_baseBuildDirectory.absolutePath(),
+                                                                    m_options.shardIndex, m_options.shardCount);
+        if (!stagedOutput.setJournal(journalFilePath))
+            throw ErrorInfo(Tr::tr("Failed to generate %1").arg(QFileInfo(journalFilePath).fileName()));
+    }
+    if (m_options.isShardCoordinator()) {
+        m_progress.beginPhase(QStringLiteral("run %1 shard workers").arg(m_options.shardCount), 1);
+        MsvsShards::runWorkers(m_qbsExecutableFile.absoluteFilePath(), shardWorkerArguments(installOptions),
+                               m_baseBuildDirectory.absolutePath(), m_options.shardCount, m_progress);
+        m_progress.advance();
+    }
 
+    memoryAccounting.beginPhase(QStringLiteral("prepare"));
+    statistics.beginPhase(QStringLiteral("prepare"));
+    m_progress.beginPhase(QStringLiteral("prepare"), projects().size());
+    MsvsSelection selection(m_options.products, m_options.configurations);
+    if (m_options.shardCount > 1)
+        selection.setShard(m_options.shardIndex, m_options.shardCount);
     MsvsPreparedProject project;
+    foreach (const Project &qbsProject, projects()) {
+        m_progress.checkCanceled();
+        MsvsProjectConfiguration config(qbsProject,
+                                        m_qbsExecutableFile.absoluteFilePath(),
+                                        m_qbsProjectFile.absoluteFilePath(),
+                                        m_baseBuildDirectory.absolutePath(),
+                                        installOptions.installRoot(),
+                                        !m_multipleProfiles);
+        config.buildCommand = m_options.buildCommand;
+        if (selection.selectsConfiguration(config))
+            project.prepare(qbsProject, installOptions, qbsProject.projectData(), config, selection);
+        m_progress.advance();
+    }
+    if (project.enabledConfigurations.isEmpty() && !m_options.configurations.isEmpty()) {
+        throw ErrorInfo(Tr::tr("No configuration matches '%1'")
+                        .arg(m_options.configurations.join(QLatin1Char(','))));
+    }
+    if (m_options.hierarchicalLayout)
+        project.assignOutputSubdirectories();
+    if (m_options.isShardCoordinator())
+        readShardSummaries(project);
+    memoryAccounting.recordPreparedProject(project);
+    memoryAccounting.endPhase();
+    statistics.endPhase();
+    if (statistics.isEnabled()) {
+        const QList<QSharedPointer<MsvsPreparedProduct> > allProducts = project.allProducts();
+        const int selectedProducts = std::count_if(allProducts.cbegin(), allProducts.cend(),
+                                                   [](const QSharedPointer<MsvsPreparedProduct> &product) {
+            return product->isSelected;
+        });
+        statistics.setProductCounts(allProducts.size(), selectedProducts, project.enabledConfigurations.size());
+    }
+
+    // The helper files are written by the coordinator.
+    const bool isShardWorker = m_options.isShardWorker();
+    if (!isShardWorker && m_options.buildTiming && !MsvsBuildTiming::writeScript(m_baseBuildDirectory.absolutePath())) {
+        throw ErrorInfo(Tr::tr("Failed to generate %1")
+                        .arg(MsvsBuildTiming::scriptFilePath(m_baseBuildDirectory.absolutePath())));
+    }
+
+    if (!isShardWorker && m_options.jobPoolSize > 0 && !MsvsJobPool::writeScript(m_baseBuildDirectory.absolutePath())) {
+        throw ErrorInfo(Tr::tr("Failed to generate %1")
+                        .arg(MsvsJobPool::scriptFilePath(m_baseBuildDirectory.absolutePath())));
+    }
+
+    if (!m_options.openFolderDirectory.isEmpty()) {
+        memoryAccounting.beginPhase(QStringLiteral("write open folder"));
+        statistics.beginPhase(QStringLiteral("write open folder"));
+        m_progress.beginPhase(QStringLiteral("write Open Folder metadata"), 1);
+        const QString folderPath = m_baseBuildDirectory.absoluteFilePath(m_options.openFolderDirectory);
+        if (!MsvsOpenFolderWriter(m_options).write(project, folderPath))
+            throw ErrorInfo(Tr::tr("Failed to generate the Open Folder files in %1").arg(folderPath));
+        m_progress.advance();
+        memoryAccounting.endPhase();
+        statistics.endPhase();
+    }
+
+    if (!m_options.compileCommandsConfiguration.isEmpty()) {
+        memoryAccounting.beginPhase(QStringLiteral("write compilation database"));
+        statistics.beginPhase(QStringLiteral("write compilation database"));
+        m_progress.beginPhase(QStringLiteral("write compilation database"), 1);
+        const MsvsSelection configurationSelection(QStringList(),
+                                                   QStringList(m_options.compileCommandsConfiguration));
+        const auto buildTask = std::find_if(project.enabledConfigurations.cbegin(),
+                                            project.enabledConfigurations.cend(),
+                                            [&](const MsvsProjectConfiguration &config) {
+            return configurationSelection.selectsConfiguration(config);
+        });
+        if (buildTask == project.enabledConfigurations.cend()) {
+            throw ErrorInfo(Tr::tr("No configuration matches '%1'")
+                            .arg(m_options.compileCommandsConfiguration));
+        }
+        const QString buildDirectory = m_baseBuildDirectory.absolutePath();
+        if (!MsvsCompilationDatabaseWriter(m_options).write(project, *buildTask, buildDirectory)) {
+            throw ErrorInfo(Tr::tr("Failed to generate %1")
+                            .arg(MsvsCompilationDatabaseWriter::filePath(buildDirectory)));
+        }
+        m_progress.advance();
+        memoryAccounting.endPhase();
+        statistics.endPhase();
+    }
+
+    if (!m_multiTarget) {
+        writeVersion(m_versionInfos.first(), project, m_baseBuildDirectory.absolutePath());
+    } else {
+        for (const VisualStudioVersionInfo &versionInfo : selectedVersions()) {
+            const QString versionDirectory = QStringLiteral("vs%1").arg(versionInfo.marketingVersion());
+            if (!MsvsStagedOutput::instance().isArchive() && !m_baseBuildDirectory.mkpath(versionDirectory))
+                throw ErrorInfo(Tr::tr("Failed to create directory %1").arg(m_baseBuildDirectory.absoluteFilePath(versionDirectory)));
+            writeVersion(versionInfo, project, m_baseBuildDirectory.absoluteFilePath(versionDirectory));
+        }
+    }
+
+    if (isShardWorker) {
+        QStringList productNames;
+        for (const QSharedPointer<MsvsPreparedProduct> &product : project.allProducts())
+            if (product->isSelected)
+                productNames << product->name;
+        productNames.sort();
+        const QString summaryFilePath = MsvsShards::summaryFilePath(m_baseBuildDirectory.absolutePath(),
+                                                                    m_options.shardIndex, m_options.shardCount);
+        if (!MsvsShards::writeSummary(summaryFilePath, m_options.shardIndex, m_options.shardCount, productNames))
+            throw ErrorInfo(Tr::tr("Failed to generate %1").arg(QFileInfo(summaryFilePath).fileName()));
+    }
+}
+
+// Built from the resolved configurations rather than taken from the own command line,
+// as the generator may run inside a host embedding the qbs library.
+QStringList VisualStudioGenerator::shardWorkerArguments(const InstallOptions &installOptions) const
+{
+    QStringList arguments = QStringList()
+            << QStringLiteral("generate")
+            << QStringLiteral("-g") << generatorName()
+            << QStringLiteral("-f") << m_qbsProjectFile.absoluteFilePath()
+            << QStringLiteral("-d") << m_baseBuildDirectory.absolutePath();
+    if (!installOptions.installRoot().isEmpty())
+        arguments << QStringLiteral("--install-root") << installOptions.installRoot();
     foreach (const Project &qbsProject, projects()) {
         const MsvsProjectConfiguration config(qbsProject,
                                               m_qbsExecutableFile.absoluteFilePath(),
@@ -107,35 +393,186 @@ void VisualStudioGenerator::generate(const InstallOptions &installOptions)
                                               m_baseBuildDirectory.absolutePath(),
                                               installOptions.installRoot(),
                                               !m_multipleProfiles);
-        project.prepare(qbsProject, installOptions, qbsProject.projectData(), config);
+        arguments << config.variant << QStringLiteral("profile:") + config.profile
+                  << config.commandLineParameters;
+    }
+    return arguments;
+}
+
+void VisualStudioGenerator::readShardSummaries(MsvsPreparedProject &project) const
+{
+    QHash<QString, QSharedPointer<MsvsPreparedProduct> > products;
+    for (const QSharedPointer<MsvsPreparedProduct> &product : project.allProducts())
+        products.insert(product->name, product);
+
+    for (int i = 0; i < m_options.shardCount; ++i) {
+        const QString summaryFilePath = MsvsShards::summaryFilePath(m_baseBuildDirectory.absolutePath(),
+                                                                    i, m_options.shardCount);
+        QStringList productNames;
+        if (!MsvsShards::readSummary(summaryFilePath, i, m_options.shardCount, &productNames))
+            throw ErrorInfo(Tr::tr("Failed to read the summary of shard %1: %2").arg(i).arg(summaryFilePath));
+        for (const QString &productName : productNames) {
+            const QSharedPointer<MsvsPreparedProduct> product = products.value(productName);
+            if (product)
+                product->isWrittenByShard = true;
+        }
+    }
+}
+
+QList<VisualStudioVersionInfo> VisualStudioGenerator::selectedVersions() const
+{
+    if (m_options.versions.isEmpty())
+        return m_versionInfos;
+
+    QList<VisualStudioVersionInfo> result;
+    for (const QString &version : m_options.versions) {
+        bool found = false;
+        for (const VisualStudioVersionInfo &versionInfo : m_versionInfos) {
+            if (versionInfo.marketingVersion() == version) {
+                result << versionInfo;
+                found = true;
+                break;
+            }
+        }
+        if (!found)
+            throw ErrorInfo(Tr::tr("Unknown Visual Studio version '%1'").arg(version));
     }
+    return result;
+}
+
+void VisualStudioGenerator::writeVersion(const VisualStudioVersionInfo &versionInfo,
+                                         const MsvsPreparedProject &project,
+                                         const QString &outputDirectory) const
+{
+    MsvsMemoryAccounting &memoryAccounting = MsvsMemoryAccounting::instance();
+    MsvsStatistics &statistics = MsvsStatistics::instance();
 
     QSharedPointer<VisualStudioXmlProjectWriter> writer;
-    if (m_versionInfo.usesMsBuild())
-        writer = QSharedPointer<MSBuildProjectWriter>::create(m_versionInfo);
-    else if (m_versionInfo.usesVcBuild())
-        writer = QSharedPointer<VCBuildProjectWriter>::create(m_versionInfo);
+    QSharedPointer<MSBuildProjectWriter> msbuildWriter;
+    if (versionInfo.usesMsBuild())
+        writer = msbuildWriter = QSharedPointer<MSBuildProjectWriter>::create(versionInfo, m_options);
+    else if (versionInfo.usesVcBuild())
+        writer = QSharedPointer<VCBuildProjectWriter>::create(versionInfo, m_options);
     else
         throw ErrorInfo(Tr::tr("Failed to generate project for unknown build engine"));
 
-    for (QSharedPointer<MsvsPreparedProduct> product : project.allProducts())
-        if (!writer->writeProjectFile(*product.data(), m_baseBuildDirectory.absolutePath()))
-            throw ErrorInfo(Tr::tr("Failed to generate %1").arg(product->name + writer->projectFileExtension()));
+    const MsvsProjectCache cache(m_options.cacheDirectory);
 
-    if (m_versionInfo.usesSolutions()) {
+    memoryAccounting.beginPhase(QStringLiteral("write projects"));
+    statistics.beginPhase(QStringLiteral("write projects"));
+    QList<QSharedPointer<MsvsPreparedProduct> > products;
+    for (const QSharedPointer<MsvsPreparedProduct> &product : project.allProducts())
+        if (product->isSelected)
+            products << product;
+    m_progress.beginPhase(QStringLiteral("write Visual Studio %1 projects").arg(versionInfo.marketingVersion()),
+                          products.size());
+    MsvsParallel::forEach(products.size(), [&](int index) {
+        m_progress.checkCanceled();
+        QElapsedTimer timer;
+        timer.start();
+        const MsvsPreparedProduct &product = *products.at(index).data();
+        const QStringList outputFilePaths = writer->outputFilePaths(product, outputDirectory);
+        if (!product.outputSubdirectory.isEmpty() && !MsvsStagedOutput::instance().isArchive()
+                && !QDir().mkpath(QFileInfo(outputFilePaths.first()).path())) {
+            throw ErrorInfo(Tr::tr("Failed to create directory %1").arg(QFileInfo(outputFilePaths.first()).path()));
+        }
+        QByteArray fingerprint;
+        if (cache.isEnabled()) {
+            fingerprint = cache.fingerprint(*writer, product, outputDirectory);
+            if (cache.restore(fingerprint, outputFilePaths)) {
+                statistics.recordProduct(product.name, timer.nsecsElapsed(), sourceFileCount(product), true);
+                m_progress.advance();
+                return;
+            }
+        }
+        if (!writer->writeProjectFile(product, outputDirectory))
+            throw ErrorInfo(Tr::tr("Failed to generate %1").arg(product.name + writer->projectFileExtension()));
+        if (cache.isEnabled())
+            cache.store(fingerprint, outputFilePaths);
+        statistics.recordProduct(product.name, timer.nsecsElapsed(), sourceFileCount(product), false);
+        m_progress.advance();
+    });
+    memoryAccounting.endPhase();
+    statistics.endPhase();
+    m_progress.checkCanceled();
+
+    if (versionInfo.usesSolutions() && !m_options.isShardWorker()) {
+        memoryAccounting.beginPhase(QStringLiteral("write solution"));
+        statistics.beginPhase(QStringLiteral("write solution"));
+        m_progress.beginPhase(QStringLiteral("write Visual Studio %1 solution").arg(versionInfo.marketingVersion()), 1);
         VisualStudioSolutionWriter solutionWriter(*writer.data());
-        const QString solutionFilePath = m_baseBuildDirectory.absoluteFilePath(m_projectName + solutionWriter.fileExtension());
+
+        // The check project needs MSBuild for its incremental target.
+        MsvsRegenerateProject regenerateProject;
+        if (msbuildWriter && m_options.regenerateProject && !project.enabledConfigurations.isEmpty()) {
+            regenerateProject.name = QStringLiteral("QBS_REGENERATE");
+            regenerateProject.guid = MsvsPreparedProject::createGuid(QStringLiteral("regenerate:") + m_projectName);
+            regenerateProject.generatorName = generatorName();
+            regenerateProject.stampFilePath = QDir(outputDirectory).absoluteFilePath(regenerateProject.name + QStringLiteral(".stamp"));
+            regenerateProject.buildSystemFiles = m_buildSystemFiles;
+            regenerateProject.environment = m_options.environment;
+            for (auto it = regenerateProject.environment.cbegin(); it != regenerateProject.environment.cend(); ++it) {
+                if (it.value().contains(QLatin1Char('"')) || it.value().contains(QLatin1Char('\n'))
+                        || it.value().contains(QLatin1Char('\r'))) {
+                    throw ErrorInfo(Tr::tr("The value of %1 contains a quote or line break, which the "
+                                           "regenerate project cannot reproduce; set "
+                                           "QBS_MSVS_REGENERATE_PROJECT=0 or change the value").arg(it.key()));
+                }
+            }
+
+            if (!msbuildWriter->writeRegenerateProjectFile(project, regenerateProject, outputDirectory))
+                throw ErrorInfo(Tr::tr("Failed to generate %1").arg(regenerateProject.name + msbuildWriter->projectFileExtension()));
+            solutionWriter.setRegenerateProject(regenerateProject,
+                                                msbuildWriter->regenerateProjectFilePath(regenerateProject, outputDirectory));
+        }
+
+        if (msbuildWriter && m_options.batchBuildProject && project.enabledConfigurations.size() > 1) {
+            MsvsBatchBuildProject batchBuildProject;
+            batchBuildProject.name = QStringLiteral("QBS_BUILD_ALL_CONFIGURATIONS");
+            batchBuildProject.guid = MsvsPreparedProject::createGuid(QStringLiteral("batchbuild:") + m_projectName);
+            if (!msbuildWriter->writeBatchBuildProjectFile(project, batchBuildProject, outputDirectory))
+                throw ErrorInfo(Tr::tr("Failed to generate %1").arg(batchBuildProject.name + msbuildWriter->projectFileExtension()));
+            solutionWriter.setBatchBuildProject(batchBuildProject,
+                                                msbuildWriter->batchBuildProjectFilePath(batchBuildProject, outputDirectory));
+        }
+
+        const QString solutionFilePath = QDir(outputDirectory).absoluteFilePath(m_projectName + solutionWriter.fileExtension());
         if (!solutionWriter.write(project, solutionFilePath))
             throw ErrorInfo(Tr::tr("Failed to generate %1").arg(QFileInfo(solutionFilePath).fileName()));
 
-        qDebug() << "Generated" << qPrintable(QFileInfo(solutionFilePath).fileName());
+        // Written last, so that the solution is only regenerated for qbs files changed afterwards.
+        if (!regenerateProject.stampFilePath.isEmpty()) {
+            if (!MsvsStagedOutput::instance().writeFile(regenerateProject.stampFilePath, QByteArray()))
+                throw ErrorInfo(Tr::tr("Failed to generate %1").arg(QFileInfo(regenerateProject.stampFilePath).fileName()));
+        }
+        memoryAccounting.endPhase();
+        statistics.endPhase();
+        m_progress.advance();
+
+        qDebug() << "Generated" << qPrintable(QDir(m_baseBuildDirectory).relativeFilePath(solutionFilePath));
     }
 }
 
+void VisualStudioGenerator::reportMemoryAccounting() const
+{
+    const MsvsMemoryAccounting &memoryAccounting = MsvsMemoryAccounting::instance();
+    if (!memoryAccounting.isEnabled())
+        return;
+    if (m_options.printMemoryReport)
+        qDebug().noquote() << memoryAccounting.report();
+    const QString memoryReportFilePath = reportFilePath(m_options.memoryReportFilePath);
+    if (!m_options.memoryReportFilePath.isEmpty() && !memoryAccounting.writeJson(memoryReportFilePath))
+        qWarning() << "Failed to write memory report to" << memoryReportFilePath;
+}
+
 QList<QSharedPointer<ProjectGenerator> > VisualStudioGenerator::createGeneratorList()
 {
     QList<QSharedPointer<ProjectGenerator> > result;
-    for (const VisualStudioVersionInfo &info : VisualStudioVersionInfo::knownVersions())
+    QList<VisualStudioVersionInfo> allVersions;
+    for (const VisualStudioVersionInfo &info : VisualStudioVersionInfo::knownVersions()) {
         result << QSharedPointer<ProjectGenerator>(new VisualStudioGenerator(info));
+        allVersions << info;
+    }
+    result << QSharedPointer<ProjectGenerator>(new VisualStudioGenerator(allVersions));
     return result;
 }
@@ -33,6 +33,8 @@
 
 #include <generators/generator.h>
 #include "msvspreparedproject.h"
+#include "msvsprogress.h"
+#include "visualstudiogeneratoroptions.h"
 #include "visualstudioxmlprojectwriter.h"
 
 #include <QFileInfo>
@@ -46,20 +48,44 @@ class VisualStudioGenerator : public ProjectGenerator
 {
 public:
     VisualStudioGenerator(const Internal::VisualStudioVersionInfo &versionInfo);
+    // Multi-target mode: writes every selected version into its own subdirectory.
+    VisualStudioGenerator(const QList<Internal::VisualStudioVersionInfo> &versionInfos);
     QString generatorName() const override;
     void generate(const InstallOptions &installOptions) override;
 
+    // Replaces the default progress output on the console.
+    void setProgressCallback(const MsvsProgress::Callback &callback);
+    // Thread-safe. The running generation stops at the next product and throws
+    // an ErrorInfo, leaving the files of the previous generation in place.
+    void cancel();
+
     static QList<QSharedPointer<ProjectGenerator> > createGeneratorList();
 
 private:
     void setupGenerator();
+    void generateStaged(const InstallOptions &installOptions);
+    // The qbs command line generating the same project in a shard worker.
+    QStringList shardWorkerArguments(const InstallOptions &installOptions) const;
+    // Marks the products written by the workers of a sharded generation.
+    void readShardSummaries(MsvsPreparedProject &project) const;
+    QList<Internal::VisualStudioVersionInfo> selectedVersions() const;
+    void writeVersion(const Internal::VisualStudioVersionInfo &versionInfo,
+                      const MsvsPreparedProject &project,
+                      const QString &outputDirectory) const;
+    void reportMemoryAccounting() const;
+    QString reportFilePath(const QString &filePath) const;
+    static int sourceFileCount(const MsvsPreparedProduct &product);
 
-    Internal::VisualStudioVersionInfo m_versionInfo;
+    QList<Internal::VisualStudioVersionInfo> m_versionInfos;
+    bool m_multiTarget = false;
+    VisualStudioGeneratorOptions m_options;
     bool m_multipleProfiles = false;
     QString m_projectName;
     QFileInfo m_qbsProjectFile;
     QDir m_baseBuildDirectory;
     QFileInfo m_qbsExecutableFile;
+    QStringList m_buildSystemFiles;
+    mutable MsvsProgress m_progress;
 };
 
 } // namespace qbs
@@ -0,0 +1,129 @@
+/****************************************************************************
+**
+** Copyright (C) 2015 The Qt Company Ltd.
+** Contact: http://www.qt.io/licensing
+**
+** This file is part of the Qt Build Suite.
+**
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms and
+** conditions see http://www.qt.io/terms-conditions. For further information
+** use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file.  Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, The Qt Company gives you certain additional
+** rights.  These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+****************************************************************************/
+
+
+#include "visualstudiogeneratoroptions.h"
+
+#include <QProcessEnvironment>
+
+namespace qbs {
+
+static QString environmentString(const char *name)
+{
+    return QString::fromLocal8Bit(qgetenv(name));
+}
+
+static QStringList environmentList(const char *name)
+{
+    QStringList result;
+    for (const QString &value : environmentString(name).split(QLatin1Char(','), QString::SkipEmptyParts))
+        result << value.trimmed();
+    return result;
+}
+
+static bool environmentFlag(const char *name, bool defaultValue = false)
+{
+    const QString value = environmentString(name).toLower();
+    if (value.isEmpty())
+        return defaultValue;
+    return value != QStringLiteral("0") && value != QStringLiteral("false");
+}
+
+bool VisualStudioGeneratorOptions::memoryAccountingEnabled() const
+{
+    return printMemoryReport || !memoryReportFilePath.isEmpty();
+}
+
+QString VisualStudioGeneratorOptions::mapPath(const QString &path) const
+{
+    for (const auto &mapping : pathMap) {
+        if (!path.startsWith(mapping.first))
+            continue;
+        const QString remainder = path.mid(mapping.first.size());
+        if (!remainder.isEmpty() && !remainder.startsWith(QLatin1Char('/'))
+                && !mapping.first.endsWith(QLatin1Char('/'))) {
+            continue;
+        }
+        return (mapping.second + remainder).replace(QLatin1Char('/'), QLatin1Char('\\'));
+    }
+    return path;
+}
+
+VisualStudioGeneratorOptions VisualStudioGeneratorOptions::fromEnvironment()
+{
+    VisualStudioGeneratorOptions options;
+    options.printMemoryReport = environmentFlag("QBS_MSVS_MEMORY_REPORT");
+    options.memoryReportFilePath = environmentString("QBS_MSVS_MEMORY_REPORT_FILE");
+    options.statisticsFilePath = environmentString("QBS_MSVS_STATISTICS_FILE");
+    options.versions = environmentList("QBS_MSVS_VERSIONS");
+    options.relativePaths = environmentFlag("QBS_MSVS_RELATIVE_PATHS");
+    options.hierarchicalLayout = environmentFlag("QBS_MSVS_HIERARCHICAL_LAYOUT");
+    options.cacheDirectory = environmentString("QBS_MSVS_CACHE_DIR");
+    options.regenerateProject = environmentFlag("QBS_MSVS_REGENERATE_PROJECT", true);
+    options.batchBuildProject = environmentFlag("QBS_MSVS_BATCH_BUILD_PROJECT", true);
+    options.jobs = environmentString("QBS_MSVS_JOBS");
+    options.jobPoolSize = qMax(0, environmentString("QBS_MSVS_JOB_POOL").toInt());
+    options.compileCommandsConfiguration = environmentString("QBS_MSVS_COMPILE_COMMANDS");
+    options.shardCount = environmentString("QBS_MSVS_SHARDS").toInt();
+    bool hasShardIndex = false;
+    const int shardIndex = environmentString("QBS_MSVS_SHARD").toInt(&hasShardIndex);
+    if (hasShardIndex)
+        options.shardIndex = shardIndex;
+    options.buildTiming = environmentFlag("QBS_MSVS_BUILD_TIMING");
+    options.products = environmentList("QBS_MSVS_PRODUCTS");
+    options.configurations = environmentList("QBS_MSVS_CONFIGURATIONS");
+    options.qtItemTypes = environmentFlag("QBS_MSVS_QT_ITEM_TYPES");
+    options.buildCommand = environmentString("QBS_MSVS_BUILD_COMMAND");
+    if (options.buildCommand.isEmpty())
+        options.buildCommand = QStringLiteral("install");
+    options.outputArchive = environmentString("QBS_MSVS_OUTPUT_ARCHIVE");
+    options.openFolderDirectory = environmentString("QBS_MSVS_OPEN_FOLDER");
+    for (const QString &mapping : environmentString("QBS_MSVS_PATH_MAP").split(QLatin1Char(';'), QString::SkipEmptyParts)) {
+        const int separator = mapping.indexOf(QLatin1Char('='));
+        if (separator > 0)
+            options.pathMap << qMakePair(mapping.left(separator).trimmed(), mapping.mid(separator + 1).trimmed());
+    }
+
+    // The regeneration from within Visual Studio updates the solution it runs from,
+    // so the variables routing the output elsewhere are not reproduced.
+    static const QStringList outputRoutingKeys = {
+        QStringLiteral("QBS_MSVS_OUTPUT_ARCHIVE"), QStringLiteral("QBS_MSVS_PATH_MAP")
+    };
+    const QProcessEnvironment environment = QProcessEnvironment::systemEnvironment();
+    for (const QString &key : environment.keys()) {
+        if (key == QStringLiteral("QBS_MSVS_SHARD") || outputRoutingKeys.contains(key))
+            continue;
+        if (key.startsWith(QStringLiteral("QBS_MSVS_")) || key == QStringLiteral("QBS_INSTALL_DIR"))
+            options.environment.insert(key, environment.value(key));
+    }
+    return options;
+}
+
+} // namespace qbs
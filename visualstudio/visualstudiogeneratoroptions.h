@@ -0,0 +1,121 @@
+/****************************************************************************
+**
+** Copyright (C) 2015 The Qt Company Ltd.
+** Contact: http://www.qt.io/licensing
+**
+** This file is part of the Qt Build Suite.
+**
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and The Qt Company. For licensing terms and
+** conditions see http://www.qt.io/terms-conditions. For further information
+** use the contact form at http://www.qt.io/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file.  Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, The Qt Company gives you certain additional
+** rights.  These rights are described in The Qt Company LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+****************************************************************************/
+
+
+#ifndef QBS_VISUALSTUDIOGENERATOROPTIONS_H
+#define QBS_VISUALSTUDIOGENERATOROPTIONS_H
+
+#include <QList>
+#include <QMap>
+#include <QPair>
+#include <QStringList>
+
+namespace qbs {
+
+/*!
+ * \brief The VisualStudioGeneratorOptions struct holds the optional generator settings.
+ * The qbs generator interface has no way to pass options, so they are read from
+ * QBS_MSVS_* environment variables, like QBS_INSTALL_DIR.
+ */
+struct VisualStudioGeneratorOptions
+{
+    // QBS_MSVS_MEMORY_REPORT: print memory accounting at the end of the generation.
+    bool printMemoryReport = false;
+    // QBS_MSVS_MEMORY_REPORT_FILE: dump memory accounting as JSON into this file.
+    QString memoryReportFilePath;
+    // QBS_MSVS_STATISTICS_FILE: write a JSON summary of counts, sizes and times of the run into this file.
+    QString statisticsFilePath;
+    // QBS_MSVS_VERSIONS: comma-separated marketing versions written by the multi-target generator.
+    QStringList versions;
+    // QBS_MSVS_RELATIVE_PATHS: write paths relative to the project files instead of absolute ones.
+    bool relativePaths = false;
+    // QBS_MSVS_HIERARCHICAL_LAYOUT: write the project files into directories mirroring the
+    // sub-project tree instead of next to the solution.
+    bool hierarchicalLayout = false;
+    // QBS_MSVS_CACHE_DIR: directory of the content-addressed cache of rendered project files.
+    QString cacheDirectory;
+    // QBS_MSVS_REGENERATE_PROJECT: add the project regenerating the solution on build (default on).
+    bool regenerateProject = true;
+    // QBS_MSVS_BATCH_BUILD_PROJECT: add the project building all configurations in one qbs
+    // invocation to solutions with several configurations (default on).
+    bool batchBuildProject = true;
+    // QBS_MSVS_JOBS: default of the QbsJobs MSBuild property, the job count of each qbs build.
+    // The property can be overridden per build, e.g. by "msbuild /p:QbsJobs=4".
+    QString jobs;
+    // QBS_MSVS_JOB_POOL: the number of qbs builds Visual Studio may run at the same time.
+    // QbsJobs then defaults to the processor count divided by this number.
+    int jobPoolSize = 0;
+    // QBS_MSVS_COMPILE_COMMANDS: also write compile_commands.json for the first configuration
+    // matching this wildcard pattern, like those of QBS_MSVS_CONFIGURATIONS.
+    QString compileCommandsConfiguration;
+    // QBS_MSVS_SHARDS: split the generation over this many worker processes, each of which
+    // prepares and writes a part of the products.
+    int shardCount = 0;
+    // QBS_MSVS_SHARD: set by the coordinating process for its workers, the shard to generate.
+    int shardIndex = -1;
+    // QBS_MSVS_BUILD_TIMING: run the build and clean commands through the timing wrapper.
+    bool buildTiming = false;
+    // QBS_MSVS_PRODUCTS: comma-separated wildcard patterns of the product names to generate.
+    QStringList products;
+    // QBS_MSVS_CONFIGURATIONS: comma-separated wildcard patterns of the configurations to generate,
+    // matched against "profile-variant|platform", "profile-variant" and the build variant.
+    QStringList configurations;
+    // QBS_MSVS_QT_ITEM_TYPES: write Qt files as the item types of the Qt Visual Studio Tools.
+    bool qtItemTypes = false;
+    // QBS_MSVS_BUILD_COMMAND: what "Build" runs in Visual Studio. "install" (default) runs qbs install,
+    // "build" only builds, "incremental-install" builds and installs the changed artifacts.
+    QString buildCommand;
+    // QBS_MSVS_OUTPUT_ARCHIVE: stream all generated files into this tar archive instead of
+    // writing them, or to the standard output for "-".
+    QString outputArchive;
+    // QBS_MSVS_PATH_MAP: semicolon-separated "from=to" prefixes, to write the absolute paths of
+    // a generation on another host as the paths of the Windows machine using the projects.
+    QList<QPair<QString, QString> > pathMap;
+    // QBS_MSVS_OPEN_FOLDER: also write the "Open Folder" metadata into this directory,
+    // usually the source directory opened in Visual Studio. Not combinable with an output archive.
+    QString openFolderDirectory;
+
+    // The generator variables as set, to reproduce them on regeneration; output
+    // routing (archive, path map) is left out.
+    QMap<QString, QString> environment;
+
+    bool memoryAccountingEnabled() const;
+    // Whether this process coordinates workers, or is one of them.
+    bool isShardCoordinator() const { return shardCount > 1 && shardIndex < 0; }
+    bool isShardWorker() const { return shardCount > 1 && shardIndex >= 0; }
+    // Applies the path map to an absolute path. Mapped paths use Windows separators.
+    QString mapPath(const QString &path) const;
+
+    static VisualStudioGeneratorOptions fromEnvironment();
+};
+
+} // namespace qbs
+
+#endif // QBS_VISUALSTUDIOGENERATOROPTIONS_H
@@ -29,11 +29,15 @@
 ****************************************************************************/
 
 #include "visualstudiosolutionwriter.h"
+#include "msvsstagedoutput.h"
+#include "msvsstatistics.h"
+#include "msvstextencoder.h"
+#include <tools/hostosinfo.h>
 #include <tools/visualstudioversioninfo.h>
 
 #include <QDir>
-#include <QFile>
 #include <QFileInfo>
+#include <QTextStream>
 #include <QUuid>
 
 namespace qbs {
@@ -51,13 +55,38 @@ QString VisualStudioSolutionWriter::fileExtension()
     return QStringLiteral(".sln");
 }
 
+QString VisualStudioSolutionWriter::projectConfigurationLines(const QString &projectGuid,
+                                                              const QString &configurationName,
+                                                              bool build)
+{
+    if (!build)
+        return QStringLiteral("\t\t%1.%2.ActiveCfg = %2\n").arg(projectGuid, configurationName);
+    return QStringLiteral("\t\t%1.%2.ActiveCfg = %2\n"
+                          "\t\t%1.%2.Build.0 = %2\n").arg(projectGuid, configurationName);
+}
+
+void VisualStudioSolutionWriter::setRegenerateProject(const MsvsRegenerateProject &regenerateProject,
+                                                      const QString &projectFilePath)
+{
+    m_regenerateProject = regenerateProject;
+    m_regenerateProjectFilePath = projectFilePath;
+}
+
+void VisualStudioSolutionWriter::setBatchBuildProject(const MsvsBatchBuildProject &batchBuildProject,
+                                                      const QString &projectFilePath)
+{
+    m_batchBuildProject = batchBuildProject;
+    m_batchBuildProjectFilePath = projectFilePath;
+}
+
 bool VisualStudioSolutionWriter::write(const MsvsPreparedProject &project, const QString &filePath)
 {
-    QFile solutionFile(filePath);
-    if (!solutionFile.open(QIODevice::WriteOnly | QIODevice::Text))
-        return false;
+    const bool hasRegenerateProject = !m_regenerateProject.guid.isEmpty();
+    const bool hasBatchBuildProject = !m_batchBuildProject.guid.isEmpty();
+    m_solutionDirectory = QFileInfo(filePath).path();
 
-    QTextStream solutionOutStream(&solutionFile);
+    QString solution;
+    QTextStream solutionOutStream(&solution);
     solutionOutStream << QStringLiteral("Microsoft Visual Studio Solution File, "
                                         "Format Version %1\n"
                                         "# Visual Studio %2\n")
@@ -65,6 +94,8 @@ bool VisualStudioSolutionWriter::write(const MsvsPreparedProject &project, const
                          .arg(m_projectWriter.versionInfo().version().majorVersion());
 
     foreach (QSharedPointer<MsvsPreparedProduct> product, project.allProducts()) {
+        if (!isInSolution(*product.data()))
+            continue;
         QString relativeProjectFilePath = QDir::toNativeSeparators(QDir(QFileInfo(filePath).path()).relativeFilePath(m_projectWriter.targetFilePath(*product.data(), QFileInfo(filePath).path())));
 
         solutionOutStream << QStringLiteral("Project(\"%1\") = \"%2\", \"%3\", \"%4\"\n")
@@ -72,6 +103,34 @@ bool VisualStudioSolutionWriter::write(const MsvsPreparedProject &project, const
                              .arg(product->name)
                              .arg(relativeProjectFilePath)
                              .arg(product->guid);
+        if (hasRegenerateProject) {
+            solutionOutStream << "\tProjectSection(ProjectDependencies) = postProject\n";
+            solutionOutStream << QStringLiteral("\t\t%1 = %1\n").arg(m_regenerateProject.guid);
+            solutionOutStream << "\tEndProjectSection\n";
+        }
+        solutionOutStream << "EndProject\n";
+    }
+
+    if (hasRegenerateProject) {
+        solutionOutStream << QStringLiteral("Project(\"%1\") = \"%2\", \"%3\", \"%4\"\n")
+                             .arg(m_solutionGuid.toString())
+                             .arg(m_regenerateProject.name)
+                             .arg(QDir::toNativeSeparators(QDir(QFileInfo(filePath).path()).relativeFilePath(m_regenerateProjectFilePath)))
+                             .arg(m_regenerateProject.guid);
+        solutionOutStream << "EndProject\n";
+    }
+
+    if (hasBatchBuildProject) {
+        solutionOutStream << QStringLiteral("Project(\"%1\") = \"%2\", \"%3\", \"%4\"\n")
+                             .arg(m_solutionGuid.toString())
+                             .arg(m_batchBuildProject.name)
+                             .arg(QDir::toNativeSeparators(QDir(QFileInfo(filePath).path()).relativeFilePath(m_batchBuildProjectFilePath)))
+                             .arg(m_batchBuildProject.guid);
+        if (hasRegenerateProject) {
+            solutionOutStream << "\tProjectSection(ProjectDependencies) = postProject\n";
+            solutionOutStream << QStringLiteral("\t\t%1 = %1\n").arg(m_regenerateProject.guid);
+            solutionOutStream << "\tEndProjectSection\n";
+        }
         solutionOutStream << "EndProject\n";
     }
 
@@ -88,11 +147,22 @@ bool VisualStudioSolutionWriter::write(const MsvsPreparedProject &project, const
 
     solutionOutStream << "\tGlobalSection(ProjectConfigurationPlatforms) = postSolution\n";
     foreach (QSharedPointer<MsvsPreparedProduct> product, project.allProducts()) {
+        if (!isInSolution(*product.data()))
+            continue;
         foreach (const MsvsProjectConfiguration &buildTask, product->configurations.keys()) {
-            solutionOutStream << QStringLiteral("\t\t%1.%2.ActiveCfg = %2\n"
-                                                "\t\t%1.%2.Build.0 = %2\n")
-                                 .arg(product->guid)
-                                 .arg(buildTask.fullName());
+            solutionOutStream << projectConfigurationLines(product->guid, buildTask.fullName());
+        }
+    }
+    if (hasRegenerateProject) {
+        foreach (const MsvsProjectConfiguration &buildTask, project.enabledConfigurations) {
+            solutionOutStream << projectConfigurationLines(m_regenerateProject.guid,
+                                                           buildTask.fullName());
+        }
+    }
+    if (hasBatchBuildProject) {
+        foreach (const MsvsProjectConfiguration &buildTask, project.enabledConfigurations) {
+            solutionOutStream << projectConfigurationLines(m_batchBuildProject.guid,
+                                                           buildTask.fullName(), false);
         }
     }
 
@@ -106,7 +176,18 @@ bool VisualStudioSolutionWriter::write(const MsvsPreparedProject &project, const
     solutionOutStream << "\tEndGlobalSection\n";
     solutionOutStream << "EndGlobal\n";
 
-    return solutionOutStream.status() == QTextStream::Ok && solutionFile.flush();
+    solutionOutStream.flush();
+
+    // UTF-8 with byte order mark, like the solutions written by Visual Studio.
+    QByteArray data("\xef\xbb\xbf");
+    data.reserve(solution.size() + 3);
+    MsvsTextEncoder::appendUtf8(data, solution);
+
+    // Text mode used to write the native line endings.
+    if (Internal::HostOsInfo::isWindowsHost())
+        data.replace("\n", "\r\n");
+    MsvsStatistics::instance().recordRendered(data.size());
+    return MsvsStagedOutput::instance().writeFile(filePath, data);
 }
 
 void VisualStudioSolutionWriter::writeProjectSubFolders(QTextStream &solutionOutStream, const MsvsPreparedProject &project) const
@@ -127,7 +208,15 @@ void VisualStudioSolutionWriter::writeNestedProjects(QTextStream &solutionOutStr
         writeNestedProjects(solutionOutStream, subProject);
 
     foreach (QSharedPointer<MsvsPreparedProduct> product, project.products.values())
-        solutionOutStream << QStringLiteral("\t\t%1 = %2\n").arg(product->guid).arg(project.guid);
+        if (isInSolution(*product.data()))
+            solutionOutStream << QStringLiteral("\t\t%1 = %2\n").arg(product->guid).arg(project.guid);
+}
+
+// Unselected products keep their place in the solution, if a previous run wrote their project files.
+bool VisualStudioSolutionWriter::isInSolution(const MsvsPreparedProduct &product) const
+{
+    return product.isSelected || product.isWrittenByShard
+            || QFileInfo(m_projectWriter.targetFilePath(product, m_solutionDirectory)).exists();
 }
 
 } // namespace qbs
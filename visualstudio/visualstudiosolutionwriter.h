@@ -46,6 +46,20 @@ public:
 
     static QString fileExtension();
 
+    // The ProjectConfigurationPlatforms lines mapping a solution configuration to a project,
+    // which builds in it unless build is false.
+    static QString projectConfigurationLines(const QString &projectGuid,
+                                             const QString &configurationName, bool build = true);
+
+    // Adds the check project all other projects depend on.
+    void setRegenerateProject(const MsvsRegenerateProject &regenerateProject,
+                              const QString &projectFilePath);
+
+    // Adds the project building all configurations at once. It is not part of
+    // the solution configurations, so it only builds when built explicitly.
+    void setBatchBuildProject(const MsvsBatchBuildProject &batchBuildProject,
+                              const QString &projectFilePath);
+
     bool write(const MsvsPreparedProject &project, const QString &filePath);
 
 protected:
@@ -53,10 +67,16 @@ protected:
                                 const MsvsPreparedProject &project) const;
     void writeNestedProjects(QTextStream &solutionOutStream,
                              const MsvsPreparedProject &project) const;
+    bool isInSolution(const MsvsPreparedProduct &product) const;
 
 private:
     const VisualStudioXmlProjectWriter &m_projectWriter;
     const QUuid m_solutionGuid;
+    MsvsRegenerateProject m_regenerateProject;
+    QString m_regenerateProjectFilePath;
+    MsvsBatchBuildProject m_batchBuildProject;
+    QString m_batchBuildProjectFilePath;
+    QString m_solutionDirectory;
 };
 
 } // namespace qbs
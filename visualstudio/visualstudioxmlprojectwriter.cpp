@@ -29,60 +29,117 @@
 ****************************************************************************/
 
 #include "visualstudioxmlprojectwriter.h"
+#include "msvsbuildtiming.h"
+#include "msvsjobpool.h"
+#include "msvsmemoryaccounting.h"
+#include "msvsparallel.h"
+#include "msvsrenderbuffer.h"
+#include "msvsstagedoutput.h"
+#include "msvsstatistics.h"
 #include "visualstudiosolutionwriter.h"
 
 #include <QDebug>
 #include <QDir>
-#include <QFile>
 #include <QFileInfo>
 #include <QTextStream>
 #include <QUuid>
-#include <QXmlStreamWriter>
+
+#include <algorithm>
 
 #include <logging/translator.h>
+#include <tools/qbsassert.h>
 #include <tools/shellutils.h>
 
 using namespace qbs;
 
-VisualStudioXmlProjectWriter::VisualStudioXmlProjectWriter(const Internal::VisualStudioVersionInfo &versionInfo)
+VisualStudioXmlProjectWriter::VisualStudioXmlProjectWriter(const Internal::VisualStudioVersionInfo &versionInfo,
+                                                           const VisualStudioGeneratorOptions &options)
     : m_versionInfo(versionInfo)
+    , m_options(options)
     , m_filterOptions(VisualStudioItemGroupFilter::defaultItemGroupFilters())
 {
 }
 
 QString VisualStudioXmlProjectWriter::targetFilePath(const MsvsPreparedProduct &product, const QString &baseBuildDirectory) const
 {
-    return QDir(baseBuildDirectory).absoluteFilePath(product.name + projectFileExtension());
+    const QString fileName = product.name + projectFileExtension();
+    if (product.outputSubdirectory.isEmpty())
+        return QDir(baseBuildDirectory).absoluteFilePath(fileName);
+    return QDir(baseBuildDirectory).absoluteFilePath(product.outputSubdirectory + QLatin1Char('/') + fileName);
+}
+
+QStringList VisualStudioXmlProjectWriter::outputFilePaths(const MsvsPreparedProduct &product, const QString &baseBuildDirectory) const
+{
+    return QStringList() << targetFilePath(product, baseBuildDirectory);
 }
 
 bool VisualStudioXmlProjectWriter::writeProjectFile(const MsvsPreparedProduct &product, const QString &baseBuildDirectory) const
 {
+    const QString projectFilePath = targetFilePath(product, baseBuildDirectory);
+    const QString projectDirectory = QFileInfo(projectFilePath).path();
+
     ProjectConfigurations allProjectFilesConfigurations;
+    ProjectFileTags allProjectFileTags;
     const QSet<MsvsProjectConfiguration> allConfigurations = product.configurations.keys().toSet();
     foreach (const MsvsProjectConfiguration &buildTask, allConfigurations) {
         const ProductData &productData = product.configurations[buildTask];
         foreach (const GroupData &groupData, productData.groups()) {
             if (groupData.isEnabled()) {
-                foreach (const QString &filePath, groupData.allFilePaths()) {
+                foreach (const ArtifactData &artifact, groupData.allSourceArtifacts()) {
+                    const QString filePath = projectPath(artifact.filePath(), projectDirectory);
                     allProjectFilesConfigurations[filePath] << buildTask;
+                    allProjectFileTags[filePath].unite(artifact.fileTags().toSet());
                 }
             }
         }
     }
 
-    QFile file(targetFilePath(product, baseBuildDirectory));
-    if (!file.open(QIODevice::WriteOnly))
-        return false;
+    MsvsMemoryAccounting &memoryAccounting = MsvsMemoryAccounting::instance();
+    if (memoryAccounting.isEnabled()) {
+        memoryAccounting.record(QStringLiteral("per-file configuration table"),
+                                MsvsMemoryAccounting::sizeOf(allProjectFilesConfigurations),
+                                allProjectFilesConfigurations.size());
+    }
 
-    QXmlStreamWriter xmlWriter(&file);
+    MsvsRenderBuffer buffer;
+    MsvsXmlWriter xmlWriter(buffer.device());
     xmlWriter.setAutoFormatting(true);
 
     writeHeader(xmlWriter, product);
-    writeConfigurations(xmlWriter, product, allConfigurations);
-    writeFiles(xmlWriter, allConfigurations, allProjectFilesConfigurations);
+    writeConfigurations(xmlWriter, product, allConfigurations, projectDirectory);
+    writeFiles(xmlWriter, allConfigurations, allProjectFilesConfigurations, allProjectFileTags);
+    writeUpToDateCheck(xmlWriter, product, projectDirectory);
     writeFooter(xmlWriter);
 
-    return !xmlWriter.hasError() && file.flush();
+    if (xmlWriter.hasError())
+        return false;
+    if (memoryAccounting.isEnabled()) {
+        memoryAccounting.record(QStringLiteral("rendered project buffers"), buffer.size(), 1);
+        memoryAccounting.record(QStringLiteral("render buffer capacity"), buffer.capacity(), 1);
+    }
+
+    MsvsStatistics::instance().recordRendered(buffer.size());
+    return MsvsStagedOutput::instance().writeFile(projectFilePath, buffer.data());
+}
+
+QString VisualStudioXmlProjectWriter::projectPath(const QString &path, const QString &projectDirectory) const
+{
+    if (path.isEmpty())
+        return path;
+    if (!m_options.relativePaths)
+        return m_options.mapPath(path);
+    return QDir::toNativeSeparators(QDir(projectDirectory).relativeFilePath(path));
+}
+
+QStringList VisualStudioXmlProjectWriter::projectPaths(const QStringList &paths, const QString &projectDirectory) const
+{
+    if (!m_options.relativePaths && m_options.pathMap.isEmpty())
+        return paths;
+    QStringList result;
+    result.reserve(paths.size());
+    for (const QString &path : paths)
+        result << projectPath(path, projectDirectory);
+    return result;
 }
 
 Internal::VisualStudioVersionInfo VisualStudioXmlProjectWriter::versionInfo() const
@@ -90,33 +147,165 @@ Internal::VisualStudioVersionInfo VisualStudioXmlProjectWriter::versionInfo() co
     return m_versionInfo;
 }
 
+VisualStudioGeneratorOptions VisualStudioXmlProjectWriter::options() const
+{
+    return m_options;
+}
+
+QString VisualStudioXmlProjectWriter::projectDirectoryPath(const QString &directory, const QString &projectDirectory) const
+{
+    if (directory.isEmpty())
+        return directory;
+    if (!m_options.relativePaths)
+        return m_options.mapPath(directory);
+    // Both writers expand $(ProjectDir) with a trailing separator.
+    const QString relativePath = QDir(projectDirectory).relativeFilePath(QDir::cleanPath(directory));
+    if (relativePath.isEmpty() || relativePath == QStringLiteral("."))
+        return QStringLiteral("$(ProjectDir)");
+    return QStringLiteral("$(ProjectDir)") + QDir::toNativeSeparators(relativePath) + QLatin1Char('\\');
+}
+
 QString VisualStudioXmlProjectWriter::qbsCommandLine(const QString &subCommand,
                                        const MsvsPreparedProduct &product,
-                                       const MsvsProjectConfiguration &buildTask) const
+                                       const MsvsProjectConfiguration &buildTask,
+                                       const QString &projectDirectory) const
+{
+    return qbsCommandLine(subCommand, product.name, QList<MsvsProjectConfiguration>() << buildTask, projectDirectory);
+}
+
+QString VisualStudioXmlProjectWriter::qbsCommandLine(const QString &subCommand,
+                                                     const QString &productName,
+                                                     const QList<MsvsProjectConfiguration> &buildTasks,
+                                                     const QString &projectDirectory) const
 {
+    QBS_CHECK(!buildTasks.isEmpty());
+    // The configurations differ in profile and variant only.
+    const MsvsProjectConfiguration &buildTask = buildTasks.first();
+
     // "path/to/qbs.exe" {build|clean} -f "path/to/project.qbs" -d "/build/directory/" -p product_name {debug|release} profile:<profileName>
+    // With relocatable output the paths are relative to the project directory, which is the working
+    // directory of the build commands.
     QStringList commandLineArgs = QStringList()
-            << QStringLiteral("-f") << QDir::toNativeSeparators(buildTask.qbsProjectFile)
-            << QStringLiteral("-d") << QDir::toNativeSeparators(buildTask.buildDirectory)
-            << QStringLiteral("-p") << product.name
-            << buildTask.variant
-            << QStringLiteral("profile:") + buildTask.profile
-            << buildTask.commandLineParameters;
-
-    if (subCommand == QStringLiteral("install") && !buildTask.installRoot.isEmpty())
+            << QStringLiteral("-f") << QDir::toNativeSeparators(projectPath(buildTask.qbsProjectFile, projectDirectory))
+            << QStringLiteral("-d") << QDir::toNativeSeparators(projectPath(buildTask.buildDirectory, projectDirectory));
+    if (!productName.isEmpty())
+        commandLineArgs << QStringLiteral("-p") << productName;
+    for (const MsvsProjectConfiguration &configuration : buildTasks)
+        commandLineArgs << configuration.variant
+                        << QStringLiteral("profile:") + configuration.profile
+                        << configuration.commandLineParameters;
+
+    const bool installs = subCommand == QStringLiteral("install")
+            || (subCommand == QStringLiteral("build") && buildTask.installsOnBuild());
+    if (installs && !buildTask.installRoot.isEmpty())
         commandLineArgs = QStringList() << QStringLiteral("--install-root")
-                                        << QDir::toNativeSeparators(buildTask.installRoot)
+                                        << QDir::toNativeSeparators(projectPath(buildTask.installRoot, projectDirectory))
                                         << commandLineArgs;
+    if (subCommand == QStringLiteral("build") && !buildTask.installsOnBuild())
+        commandLineArgs.prepend(QStringLiteral("--no-install"));
+
+    // The timing wrapper picks up the qbs phase timings from the --log-time output.
+    if (m_options.buildTiming && subCommand != QStringLiteral("clean"))
+        commandLineArgs.prepend(QStringLiteral("--log-time"));
+
+    const bool isClean = subCommand == QStringLiteral("clean");
+    QString commandLine = Internal::shellQuote(QDir::toNativeSeparators(projectPath(buildTask.qbsExecutablePath, projectDirectory)),
+                                               QStringList() << subCommand, Internal::HostOsInfo::HostOsWindows);
+    // Expanded by the IDE, so it must not be quoted.
+    const QString jobCount = jobCountArgument();
+    if (!isClean && !jobCount.isEmpty())
+        commandLine += QLatin1Char(' ') + jobCount;
+    commandLine += QLatin1Char(' ') + Internal::shellQuote(commandLineArgs, Internal::HostOsInfo::HostOsWindows);
+
+    // The timing wrapper runs inside the pool slot, so that the timings do not include
+    // the wait for a free slot.
+    if (m_options.buildTiming)
+        commandLine = MsvsBuildTiming::wrapCommandLine(commandLine,
+                                                       projectPath(MsvsBuildTiming::scriptFilePath(buildTask.buildDirectory), projectDirectory),
+                                                       productName.isEmpty() ? QStringLiteral("(all)") : productName,
+                                                       buildTasks.size() == 1 ? buildTask.fullName() : QStringLiteral("(all)"),
+                                                       subCommand);
+    if (m_options.jobPoolSize > 0 && !isClean)
+        commandLine = MsvsJobPool::wrapCommandLine(commandLine,
+                                                   projectPath(MsvsJobPool::scriptFilePath(buildTask.buildDirectory), projectDirectory),
+                                                   buildTask.buildDirectory, m_options.jobPoolSize);
+    return commandLine;
+}
+
+QString VisualStudioXmlProjectWriter::jobCountArgument() const
+{
+    return QString();
+}
+
+QString VisualStudioXmlProjectWriter::qbsBuildCommandLine(const MsvsPreparedProduct &product,
+                                                          const MsvsProjectConfiguration &buildTask,
+                                                          const QString &projectDirectory) const
+{
+    return qbsCommandLine(buildTask.buildSubCommand(), product, buildTask, projectDirectory);
+}
 
-    return Internal::shellQuote(QDir::toNativeSeparators(buildTask.qbsExecutablePath),
-                                QStringList() << subCommand << commandLineArgs,
-                                Internal::HostOsInfo::HostOsWindows);
+QVector<VisualStudioXmlProjectWriter::ProjectFile> VisualStudioXmlProjectWriter::projectFiles(
+        const QSet<MsvsProjectConfiguration> &allConfigurations,
+        const ProjectConfigurations &allProjectFilesConfigurations,
+        const ProjectFileTags &allProjectFileTags) const
+{
+    QStringList filePaths = allProjectFilesConfigurations.keys();
+    filePaths.sort();
+
+    QVector<ProjectFile> result(filePaths.size());
+    MsvsParallel::forEachChunk(filePaths.size(), MsvsParallel::fileChunkSize, [&](int begin, int end) {
+        for (int i = begin; i < end; ++i) {
+            ProjectFile &projectFile = result[i];
+            projectFile.filePath = filePaths.at(i);
+            projectFile.fileTags = allProjectFileTags.value(projectFile.filePath);
+            const QSet<MsvsProjectConfiguration> &fileConfigurations = allProjectFilesConfigurations[projectFile.filePath];
+            if (fileConfigurations.size() == allConfigurations.size())
+                continue;
+            for (const MsvsProjectConfiguration &buildTask : allConfigurations)
+                if (!fileConfigurations.contains(buildTask))
+                    projectFile.disabledConfigurations << buildTask;
+            std::sort(projectFile.disabledConfigurations.begin(), projectFile.disabledConfigurations.end());
+        }
+    });
+    return result;
+}
+
+void VisualStudioXmlProjectWriter::writeElements(MsvsXmlWriter &xmlWriter, int count,
+                                                 const std::function<void(MsvsXmlWriter &, int)> &writeElement)
+{
+    const int chunkSize = MsvsParallel::fileChunkSize;
+    if (count <= chunkSize) {
+        for (int i = 0; i < count; ++i)
+            writeElement(xmlWriter, i);
+        return;
+    }
+
+    QVector<QByteArray> fragments((count + chunkSize - 1) / chunkSize);
+    MsvsParallel::forEachChunk(count, chunkSize, [&](int begin, int end) {
+        MsvsXmlWriter fragmentWriter(&fragments[begin / chunkSize], xmlWriter);
+        for (int i = begin; i < end; ++i)
+            writeElement(fragmentWriter, i);
+    });
+    for (QByteArray &fragment : fragments) {
+        xmlWriter.writeFragment(fragment);
+        fragment.clear();
+    }
+}
+
+void VisualStudioXmlProjectWriter::writeUpToDateCheck(MsvsXmlWriter &xmlWriter,
+                                                      const MsvsPreparedProduct &product,
+                                                      const QString &projectDirectory) const
+{
+    Q_UNUSED(xmlWriter);
+    Q_UNUSED(product);
+    Q_UNUSED(projectDirectory);
 }
 
-void VisualStudioXmlProjectWriter::writeConfigurations(QXmlStreamWriter &xmlWriter,
+void VisualStudioXmlProjectWriter::writeConfigurations(MsvsXmlWriter &xmlWriter,
                                                 const MsvsPreparedProduct &product,
-                                                const QSet<MsvsProjectConfiguration> &allConfigurations) const
+                                                const QSet<MsvsProjectConfiguration> &allConfigurations,
+                                                const QString &projectDirectory) const
 {
     for (const MsvsProjectConfiguration &buildTask : allConfigurations)
-        writeConfiguration(xmlWriter, product, buildTask, product.configurations[buildTask]);
+        writeConfiguration(xmlWriter, product, buildTask, product.configurations[buildTask], projectDirectory);
 }
@@ -32,11 +32,16 @@
 #define QBS_VISUALSTUDIOXMLPROJECTWRITER_H
 
 #include "msvspreparedproject.h"
+#include "msvsxmlwriter.h"
+#include "visualstudiogeneratoroptions.h"
 #include "visualstudioitemgroupfilter.h"
 #include <tools/visualstudioversioninfo.h>
 
+#include <QVector>
+
+#include <functional>
+
 QT_BEGIN_NAMESPACE
-class QXmlStreamWriter;
 class QTextStream;
 QT_END_NAMESPACE
 
@@ -49,39 +54,92 @@ namespace qbs {
 class VisualStudioXmlProjectWriter
 {
 public:
-    VisualStudioXmlProjectWriter(const Internal::VisualStudioVersionInfo &versionInfo);
+    VisualStudioXmlProjectWriter(const Internal::VisualStudioVersionInfo &versionInfo,
+                                 const VisualStudioGeneratorOptions &options = VisualStudioGeneratorOptions());
 
     virtual QString projectFileExtension() const = 0;
     QString targetFilePath(const MsvsPreparedProduct &product,
                            const QString &baseBuildDirectory) const;
 
+    virtual QStringList outputFilePaths(const MsvsPreparedProduct &product,
+                                        const QString &baseBuildDirectory) const;
+
     virtual bool writeProjectFile(const MsvsPreparedProduct &product,
                                   const QString &baseBuildDirectory) const;
 
+    // Returns path as written into a project file located in projectDirectory,
+    // which is relative to it if relocatable output is enabled.
+    QString projectPath(const QString &path, const QString &projectDirectory) const;
+    QStringList projectPaths(const QStringList &paths, const QString &projectDirectory) const;
+
     Internal::VisualStudioVersionInfo versionInfo() const;
+    VisualStudioGeneratorOptions options() const;
 
 protected:
     QString qbsCommandLine(const QString &subCommand,
                            const MsvsPreparedProduct &product,
-                           const MsvsProjectConfiguration &buildTask) const;
+                           const MsvsProjectConfiguration &buildTask,
+                           const QString &projectDirectory) const;
+    // Runs qbs once for all given configurations, and for all products if productName is empty.
+    QString qbsCommandLine(const QString &subCommand,
+                           const QString &productName,
+                           const QList<MsvsProjectConfiguration> &buildTasks,
+                           const QString &projectDirectory) const;
+    // The job count option of the build commands, which the IDE expands. Empty by default,
+    // which leaves the job count to qbs.
+    virtual QString jobCountArgument() const;
+    // The command line run by "Build", as selected by the build command of the configuration.
+    QString qbsBuildCommandLine(const MsvsPreparedProduct &product,
+                                const MsvsProjectConfiguration &buildTask,
+                                const QString &projectDirectory) const;
+    // Like projectPath(), but for directories which are used in MSBuild/VCBuild properties.
+    QString projectDirectoryPath(const QString &directory, const QString &projectDirectory) const;
 
     typedef QHash<QString, QSet<MsvsProjectConfiguration> > ProjectConfigurations;
+    // The file tags of each project file in all configurations.
+    typedef QHash<QString, QSet<QString> > ProjectFileTags;
 
-    virtual void writeHeader(QXmlStreamWriter &xmlWriter,
+    struct ProjectFile
+    {
+        QString filePath;
+        QSet<QString> fileTags;
+        QList<MsvsProjectConfiguration> disabledConfigurations;
+    };
+
+    // Sorted by path; large products are processed in parallel chunks.
+    QVector<ProjectFile> projectFiles(const QSet<MsvsProjectConfiguration> &allConfigurations,
+                                      const ProjectConfigurations &allProjectFilesConfigurations,
+                                      const ProjectFileTags &allProjectFileTags) const;
+
+    // Writes count sibling elements. Large counts are rendered in parallel chunks into
+    // separate buffers, which are joined in order.
+    static void writeElements(MsvsXmlWriter &xmlWriter, int count,
+                              const std::function<void(MsvsXmlWriter &xmlWriter, int index)> &writeElement);
+
+    virtual void writeHeader(MsvsXmlWriter &xmlWriter,
                              const MsvsPreparedProduct &product) const = 0;
-    virtual void writeConfigurations(QXmlStreamWriter &xmlWriter,
+    virtual void writeConfigurations(MsvsXmlWriter &xmlWriter,
                                      const MsvsPreparedProduct &product,
-                                     const QSet<MsvsProjectConfiguration> &allConfigurations) const;
-    virtual void writeConfiguration(QXmlStreamWriter &xmlWriter,
+                                     const QSet<MsvsProjectConfiguration> &allConfigurations,
+                                     const QString &projectDirectory) const;
+    virtual void writeConfiguration(MsvsXmlWriter &xmlWriter,
                                     const MsvsPreparedProduct &product,
                                     const MsvsProjectConfiguration &buildTask,
-                                    const ProductData &productData) const = 0;
-    virtual void writeFiles(QXmlStreamWriter &xmlWriter,
+                                    const ProductData &productData,
+                                    const QString &projectDirectory) const = 0;
+    virtual void writeFiles(MsvsXmlWriter &xmlWriter,
                             const QSet<MsvsProjectConfiguration> &allConfigurations,
-                            const ProjectConfigurations &allProjectFilesConfigurations) const = 0;
-    virtual void writeFooter(QXmlStreamWriter &xmlWriter) const = 0;
+                            const ProjectConfigurations &allProjectFilesConfigurations,
+                            const ProjectFileTags &allProjectFileTags) const = 0;
+    // Declares the inputs and outputs of the qbs build, so that the IDE can skip
+    // invoking qbs for up-to-date products. Does nothing by default.
+    virtual void writeUpToDateCheck(MsvsXmlWriter &xmlWriter,
+                                    const MsvsPreparedProduct &product,
+                                    const QString &projectDirectory) const;
+    virtual void writeFooter(MsvsXmlWriter &xmlWriter) const = 0;
 
     const Internal::VisualStudioVersionInfo m_versionInfo;
+    const VisualStudioGeneratorOptions m_options;
     const QList<VisualStudioItemGroupFilter> m_filterOptions;
 };
 